@@ -0,0 +1,157 @@
+
+//this demo counts heap allocations (via replacing the global operator new) in steady state:
+// 1. echo round trips between a server and a client in this process (one 64 bytes message in flight), compare the numbers with and without
+//  macro ASCS_HANDLER_MEMORY (make ext_cflag=-DASCS_HANDLER_MEMORY), the difference is the allocations inside asio.
+// 2. re-arming a timer (the call back returns true) and replacing a timer's call back, both should never allocate memory.
+#include <iostream>
+#include <cstdlib>
+#include <new>
+
+//configuration
+#define ASCS_SERVER_PORT	9529
+//#define ASCS_HANDLER_MEMORY
+//#define ASCS_USE_TIMING_WHEEL
+//configuration
+
+#include <ascs/ext/tcp.h>
+using namespace ascs;
+using namespace ascs::tcp;
+using namespace ascs::ext::tcp;
+
+std::atomic_size_t alloc_num(0);
+void* operator new(size_t size)
+{
+	++alloc_num;
+	auto p = malloc(size > 0 ? size : 1);
+	if (nullptr == p)
+		throw std::bad_alloc();
+
+	return p;
+}
+void* operator new[](size_t size) {return operator new(size);}
+void operator delete(void* p) noexcept {free(p);}
+void operator delete[](void* p) noexcept {free(p);}
+void operator delete(void* p, size_t) noexcept {free(p);}
+void operator delete[](void* p, size_t) noexcept {free(p);}
+
+#define WARM_UP_NUM	2000 //let asio and ascs fill their caches
+#define TIMER_WARM_UP_NUM	100
+#ifdef ASCS_USE_TIMING_WHEEL
+#define RE_ARM_NUM	1000 //each re-arm waits for a tick of the wheel
+#else
+#define RE_ARM_NUM	100000
+#endif
+#define ROUND_TRIP_NUM	20000
+
+class counting_timer : public timer<tracked_executor>
+{
+public:
+	counting_timer(asio::io_context& io_context_) : timer<tracked_executor>(io_context_), fired(0), alloc_begin(0), alloc_end(0) {}
+
+	void begin()
+	{
+		uint64_t a = 1, b = 2, c = 3, d = 4; //captures of 40 bytes, call backs of ascs itself capture much less
+		set_timer(TIMER_END, 0, [this, a, b, c, d](tid id)->bool {return this->on_timer(a + b + c + d);});
+	}
+
+	//replace the call back of a timer which is not started
+	size_t replace_call_back(size_t num)
+	{
+		create_or_update_timer(TIMER_END + 1, 0, [](tid id)->bool {return false;}); //the first call of a new id inserts a timer object
+		auto begin_num = alloc_num.load();
+		for (size_t i = 0; i < num; ++i)
+		{
+			uint64_t a = i, b = i + 1, c = i + 2, d = i + 3;
+			create_or_update_timer(TIMER_END + 1, 0, [this, a, b, c, d](tid id)->bool {return this->on_timer(a + b + c + d);});
+		}
+
+		return alloc_num - begin_num;
+	}
+
+	bool done() const {return fired >= TIMER_WARM_UP_NUM + RE_ARM_NUM;}
+	size_t allocations() const {return alloc_end - alloc_begin;}
+
+private:
+	bool on_timer(uint64_t)
+	{
+		auto num = ++fired;
+		if (TIMER_WARM_UP_NUM == num)
+			alloc_begin = alloc_num.load();
+		else if (TIMER_WARM_UP_NUM + RE_ARM_NUM == num)
+		{
+			alloc_end = alloc_num.load();
+			return false;
+		}
+
+		return true; //re-arm
+	}
+
+private:
+	std::atomic_size_t fired, alloc_begin, alloc_end;
+};
+
+std::atomic_size_t round_trips(0), alloc_begin(0), alloc_end(0);
+
+class echo_socket : public server_socket
+{
+public:
+	echo_socket(i_server& server_) : server_socket(server_) {}
+
+protected:
+	virtual bool on_msg_handle(out_msg_type& msg) {return send_msg(std::move(msg), true);}
+};
+
+class pingpong_socket : public client_socket
+{
+public:
+	pingpong_socket(asio::io_context& io_context_) : client_socket(io_context_) {}
+
+protected:
+	virtual bool on_msg_handle(out_msg_type& msg)
+	{
+		auto num = ++round_trips;
+		if (WARM_UP_NUM == num)
+			alloc_begin = alloc_num.load();
+		else if (WARM_UP_NUM + ROUND_TRIP_NUM == num)
+		{
+			alloc_end = alloc_num.load();
+			return true;
+		}
+
+		return send_msg(std::move(msg), true);
+	}
+};
+
+int main(int argc, const char* argv[])
+{
+	printf("usage: %s [<service thread number=1>]\n", argv[0]);
+	if (argc >= 2 && (0 == strcmp(argv[1], "--help") || 0 == strcmp(argv[1], "-h")))
+		return 0;
+
+	auto thread_num = 1;
+	if (argc > 1)
+		thread_num = std::min(16, std::max(thread_num, atoi(argv[1])));
+
+	service_pump sp;
+	counting_timer t(sp);
+	server_base<echo_socket> server(sp);
+	single_client_base<pingpong_socket> client(sp);
+
+	t.begin();
+	sp.start_service(thread_num);
+
+	while (!t.done())
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	printf("timer re-arms: %d, allocations: " ASCS_SF "\n", RE_ARM_NUM, t.allocations());
+	printf("timer call back replacements: %d, allocations: " ASCS_SF "\n", RE_ARM_NUM, t.replace_call_back(RE_ARM_NUM));
+
+	while (!client.is_connected())
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	client.send_msg(std::string(64, '0'));
+	while (round_trips < WARM_UP_NUM + ROUND_TRIP_NUM)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	printf("echo round trips: %d, allocations per round trip: %f\n", ROUND_TRIP_NUM, (double) (alloc_end - alloc_begin) / ROUND_TRIP_NUM);
+
+	sp.stop_service();
+	return 0;
+}
@@ -73,7 +73,22 @@ public:
 	{
 		do_something_to_all([msg_len](object_ctype& item) {item->begin(msg_len);});
 		set_timer(TIMER_END, 5000, [=](tid id)->bool {this->do_something_to_all([max_delay](object_ctype& item) {item->check_delay(max_delay);}); return true;});
+
+		//connection rate benchmark, it's more meaningful if the server accepts connections in batch (see macro ASCS_ACCEPT_BATCH_NUM)
+		begin_time.restart();
+		set_timer(TIMER_END + 1, 10, [this](tid id)->bool {
+			auto link_num = this->size();
+			if (this->valid_size() < link_num)
+				return true;
+
+			auto used_time = begin_time.elapsed();
+			printf("all " ASCS_SF " links established in %f seconds, %f connections per second.\n", link_num, used_time, link_num / used_time);
+			return false;
+		});
 	}
+
+private:
+	cpu_timer begin_time;
 };
 
 int main(int argc, const char* argv[])
@@ -10,6 +10,7 @@
 #define ASCS_MSG_BUFFER_SIZE	1024
 #define ASCS_INPUT_QUEUE		non_lock_queue //we will never operate sending buffer concurrently, so need no locks
 #define ASCS_DECREASE_THREAD_AT_RUNTIME
+//#define ASCS_ACCEPT_BATCH_NUM	64 //accept connections in batch, run concurrent_client to see the connection rate
 //configuration
 
 #include <ascs/ext/tcp.h>
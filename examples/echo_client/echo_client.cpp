@@ -12,6 +12,7 @@
 #define ASCS_FULL_STATISTIC //full statistic will slightly impact efficiency
 #define ASCS_AVOID_AUTO_STOP_SERVICE
 #define ASCS_DECREASE_THREAD_AT_RUNTIME
+//#define ASCS_IO_URING //asio 1.21+ and liburing are needed, define it for both echo_server and echo_client, see config.h
 //#define ASCS_MAX_SEND_BUF	65536
 //#define ASCS_MAX_RECV_BUF	65536
 //if there's a huge number of links, please reduce messge buffer via ASCS_MAX_SEND_BUF and ASCS_MAX_RECV_BUF macro.
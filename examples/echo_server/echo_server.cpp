@@ -9,10 +9,13 @@
 #define ASCS_DISPATCH_BATCH_MSG
 #define ASCS_ENHANCED_STABILITY
 //#define ASCS_FULL_STATISTIC //full statistic will slightly impact efficiency
+//#define ASCS_ATOMIC_STATISTIC //gather statistic per service thread too, then service_pump::get_statistic() can be used without locking object pools
+//#define ASCS_LOOP_MONITOR //scheduling lag, busy time and latency histograms, needs ASCS_FULL_STATISTIC and ASCS_ATOMIC_STATISTIC
 #define ASCS_USE_STEADY_TIMER
 #define ASCS_ALIGNED_TIMER
 #define ASCS_AVOID_AUTO_STOP_SERVICE
 #define ASCS_DECREASE_THREAD_AT_RUNTIME
+//#define ASCS_IO_URING //asio 1.21+ and liburing are needed, define it for both echo_server and echo_client, see config.h
 //#define ASCS_MAX_SEND_BUF	65536
 //#define ASCS_MAX_RECV_BUF	65536
 //if there's a huge number of links, please reduce messge buffer via ASCS_MAX_SEND_BUF and ASCS_MAX_RECV_BUF macro.
@@ -259,6 +262,14 @@ int main(int argc, const char* argv[])
 			printf("normal server, link #: " ASCS_SF ", invalid links: " ASCS_SF "\n", normal_server_.size(), normal_server_.invalid_object_size());
 			printf("echo server, link #: " ASCS_SF ", invalid links: " ASCS_SF "\n\n", echo_server_.size(), echo_server_.invalid_object_size());
 			puts(echo_server_.get_statistic().to_string().data());
+#ifdef ASCS_ATOMIC_STATISTIC
+			puts("\nall service threads (lock-free):");
+			puts(sp.get_statistic().to_string().data());
+#endif
+#ifdef ASCS_LOOP_MONITOR
+			puts("\nservice pump:");
+			puts(sp.get_loop_statistic().to_string().data());
+#endif
 		}
 		else if (STATUS == str)
 		{
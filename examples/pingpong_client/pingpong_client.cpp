@@ -11,6 +11,8 @@
 #define ASCS_INPUT_QUEUE non_lock_queue //we will never operate sending buffer concurrently, so need no locks
 #define ASCS_DEFAULT_UNPACKER stream_unpacker //non-protocol
 #define ASCS_DECREASE_THREAD_AT_RUNTIME
+//#define ASCS_BUSY_POLL //service threads spin before blocking, compare the average round trip time (use 1 link) with and without it
+//#define ASCS_BUSY_POLL_SPIN	100 //microseconds, 50 by default
 //configuration
 
 #include <ascs/ext/tcp.h>
@@ -196,6 +198,10 @@ int main(int argc, const char* argv[])
 			uint64_t total_msg_bytes = link_num; total_msg_bytes *= msg_len; total_msg_bytes *= msg_num;
 			printf("finished in %f seconds, TPS: %f(*2), speed: %f(*2) MBps.\n",
 				begin_time.elapsed(), link_num * msg_num / begin_time.elapsed(), total_msg_bytes / begin_time.elapsed() / 1024 / 1024);
+#ifndef ASCS_WANT_MSG_SEND_NOTIFY
+			//each link sends the next message after the previous one came back (if the message is not split), so this is the latency
+			printf("average round trip time: %f microseconds.\n", begin_time.elapsed() * 1000000 / msg_num);
+#endif
 
 			delete[] init_msg;
 		}
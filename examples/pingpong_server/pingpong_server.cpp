@@ -16,6 +16,8 @@
 //undefined behavior, please note.
 #define ASCS_DEFAULT_UNPACKER stream_unpacker //non-protocol
 #define ASCS_DECREASE_THREAD_AT_RUNTIME
+//#define ASCS_BUSY_POLL //service threads spin before blocking, compare the average round trip time (use 1 link) with and without it
+//#define ASCS_BUSY_POLL_SPIN	100 //microseconds, 50 by default
 //configuration
 
 #include <ascs/ext/tcp.h>
@@ -31,7 +31,19 @@
 #elif defined(ASCS_SYNC_RECV)
 #include <condition_variable>
 #endif
+#ifdef ASCS_LOOP_MONITOR
+#include <cmath>
+#include <algorithm>
+#endif
 
+#ifdef ASCS_IO_URING //must take effect before including asio, see config.h
+	#ifndef ASIO_HAS_IO_URING
+	#define ASIO_HAS_IO_URING
+	#endif
+	#ifndef ASIO_DISABLE_EPOLL
+	#define ASIO_DISABLE_EPOLL //then io_uring becomes the default backend for all I/O
+	#endif
+#endif
 #include <asio.hpp>
 
 #include "config.h"
@@ -292,6 +304,13 @@ public:
 	virtual bool pack_msg(msg_type&& msg1, msg_type&& msg2, container_type& msg_can) {return false;}
 	virtual bool pack_msg(container_type&& in, container_type& out) {return false;}
 	virtual msg_type pack_heartbeat() {return msg_type();}
+	//pack the message and append it to msg (which can already hold packed messages), return false if failed or not supported (then nothing changed),
+	// see macro ASCS_APPEND_SEND_MSG.
+	virtual bool append_msg(msg_type& msg, const char* const pstr[], const size_t len[], size_t num, bool native = false) {return false;}
+	//in-place message building: prepare_msg returns a message which has room for the header at the front (and reserved room for body_len bytes),
+	// the user appends the body to it, then finalize_msg fills the header in place (return false if failed or not supported).
+	virtual msg_type prepare_msg(size_t body_len = 0) {return msg_type();}
+	virtual bool finalize_msg(msg_type& msg) {return false;}
 	virtual char* raw_data(msg_type& msg) const {return nullptr;}
 	virtual const char* raw_data(msg_ctype& msg) const {return nullptr;}
 	virtual size_t raw_data_len(msg_ctype& msg) const {return 0;}
@@ -365,12 +384,41 @@ namespace udp
 } //namespace
 //unpacker concept
 
+//seconds since epoch, used by statistic (last_send_time, last_recv_time and so on) and heartbeat checking.
+//with macro ASCS_COARSE_CLOCK, it's refreshed by service_pump every ASCS_COARSE_CLOCK milliseconds, so reading it is just an atomic load,
+// otherwise (or no service_pump is refreshing it), it's time(nullptr).
+template<typename Dummy = void> class basic_coarse_clock
+{
+public:
+#ifdef ASCS_COARSE_CLOCK
+	static time_t now() {auto re = value.load(std::memory_order_relaxed); return 0 == re ? time(nullptr) : re;} //0 means not refreshing
+	static void refresh() {value.store(time(nullptr), std::memory_order_relaxed);}
+
+	//each started service_pump refreshes the clock, when the last one stopped, the clock must not be frozen at that time.
+	static void start() {++refresher_num; refresh();}
+	static void stop() {if (0 == --refresher_num) value.store(0, std::memory_order_relaxed);}
+
+private:
+	static std::atomic<time_t> value;
+	static std::atomic_int refresher_num;
+#else
+	static time_t now() {return time(nullptr);}
+#endif
+};
+#ifdef ASCS_COARSE_CLOCK
+template<typename Dummy> std::atomic<time_t> basic_coarse_clock<Dummy>::value(0);
+template<typename Dummy> std::atomic_int basic_coarse_clock<Dummy>::refresher_num(0);
+#endif
+
+typedef basic_coarse_clock<> coarse_clock;
+
 struct statistic
 {
 #ifdef ASCS_FULL_STATISTIC
-	typedef std::chrono::system_clock::time_point stat_time;
-	static stat_time now() {return std::chrono::system_clock::now();}
-	typedef std::chrono::system_clock::duration stat_duration;
+	//durations only, so a monotonic clock, it will not jump when the system time been adjusted
+	typedef std::chrono::steady_clock::time_point stat_time;
+	static stat_time now() {return std::chrono::steady_clock::now();}
+	typedef std::chrono::steady_clock::duration stat_duration;
 #else
 	struct dummy_duration {dummy_duration& operator+=(const dummy_duration& other) {return *this;}}; //not a real duration, just satisfy compiler(d1 += d2)
 	struct dummy_time {dummy_duration operator-(const dummy_time& other) {return dummy_duration();}}; //not a real time, just satisfy compiler(t1 - t2)
@@ -474,18 +522,323 @@ struct statistic
 	time_t break_time; //time of link broken
 };
 
+#ifdef ASCS_ATOMIC_STATISTIC
+//writers are serialized by a spin lock (they belong to the same socket, so it's almost never contended), readers never block writers,
+//they just retry if a writing happened during their reading, see socket::get_statistic_snapshot for example.
+class seq_lock : public asio::noncopyable
+{
+public:
+	seq_lock() : seq(0) {writing.clear();}
+
+	//for writers, compatible with std::lock_guard
+	void lock()
+	{
+		while (writing.test_and_set(std::memory_order_acquire))
+			std::this_thread::yield();
+
+		seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+	void unlock() {seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release); writing.clear(std::memory_order_release);}
+
+	//for readers
+	unsigned read_begin() const
+	{
+		unsigned s;
+		while ((s = seq.load(std::memory_order_acquire)) & 1)
+			std::this_thread::yield();
+
+		return s;
+	}
+	bool read_retry(unsigned s) const {std::atomic_thread_fence(std::memory_order_acquire); return s != seq.load(std::memory_order_relaxed);}
+
+private:
+	std::atomic_uint seq;
+	std::atomic_flag writing;
+};
+
+#ifdef ASCS_LOOP_MONITOR
+//HDR style (log-linear) histogram of durations in nanoseconds, values are grouped by their highest bit, and each group is linearly split into
+// SUB_NUM buckets, so the relative error is less than 1 / SUB_NUM (12.5%), values not less than 2^MAX_BITS nanoseconds (about 18 minutes) are clamped.
+struct histogram
+{
+	static const unsigned SUB_BITS = 3, MAX_BITS = 40;
+	static const size_t SUB_NUM = 1 << SUB_BITS;
+	static const size_t BUCKET_NUM = (MAX_BITS - SUB_BITS + 1) * SUB_NUM;
+	static const uint_fast64_t MAX_VALUE = ((uint_fast64_t) 1 << MAX_BITS) - 1;
+
+	static uint_fast64_t clamp(int_fast64_t value) {return value <= 0 ? 0 : ((uint_fast64_t) value > MAX_VALUE ? MAX_VALUE : (uint_fast64_t) value);}
+	static size_t index(uint_fast64_t value)
+	{
+		if (value < SUB_NUM)
+			return (size_t) value;
+
+#if defined(__GNUC__) || defined(__clang__)
+		auto msb = (unsigned) (63 - __builtin_clzll((unsigned long long) value));
+#else
+		auto msb = SUB_BITS;
+		while (value >> (msb + 1))
+			++msb;
+#endif
+		return (msb - SUB_BITS + 1) * SUB_NUM + (size_t) ((value >> (msb - SUB_BITS)) & (SUB_NUM - 1));
+	}
+	//the lowest value which belongs to bucket index
+	static uint_fast64_t lowest_value(size_t index)
+	{
+		if (index < SUB_NUM)
+			return index;
+
+		auto group = (unsigned) (index / SUB_NUM);
+		return (uint_fast64_t) (SUB_NUM + index % SUB_NUM) << (group - 1);
+	}
+	static uint_fast64_t highest_value(size_t index) {return index + 1 < BUCKET_NUM ? lowest_value(index + 1) - 1 : MAX_VALUE;}
+
+	histogram() {reset();}
+	void reset() {std::fill(std::begin(buckets), std::end(buckets), 0); total = sum = max_value = 0;}
+
+	void record(int_fast64_t value) {auto v = clamp(value); ++buckets[index(v)]; ++total; sum += v; max_value = std::max(max_value, v);}
+	histogram& operator+=(const histogram& other)
+	{
+		for (size_t i = 0; i < BUCKET_NUM; ++i)
+			buckets[i] += other.buckets[i];
+		total += other.total;
+		sum += other.sum;
+		max_value = std::max(max_value, other.max_value);
+
+		return *this;
+	}
+
+	uint_fast64_t count() const {return total;}
+	uint_fast64_t max() const {return max_value;}
+	uint_fast64_t mean() const {return 0 == total ? 0 : sum / total;}
+	//percent is in (0, 100], the returned value is the highest value which is equivalent (in the same bucket) to the real one
+	uint_fast64_t percentile(double percent) const
+	{
+		if (0 == total)
+			return 0;
+
+		auto rank = (uint_fast64_t) std::ceil(total * std::min(std::max(percent, 0.0), 100.0) / 100);
+		uint_fast64_t num = 0;
+		for (size_t i = 0; i < BUCKET_NUM; ++i)
+			if ((num += buckets[i]) >= std::max(rank, (uint_fast64_t) 1))
+				return std::min(highest_value(i), max_value);
+
+		return max_value;
+	}
+
+	std::string to_string() const //in microseconds
+	{
+		std::ostringstream s;
+		s << std::fixed << std::setprecision(1) << "count: " << total << ", mean: " << mean() / 1000.0 << ", p50: " << percentile(50) / 1000.0
+			<< ", p90: " << percentile(90) / 1000.0 << ", p99: " << percentile(99) / 1000.0 << ", p99.9: " << percentile(99.9) / 1000.0
+			<< ", max: " << max_value / 1000.0 << " (us)";
+		return s.str();
+	}
+
+	uint_fast64_t buckets[BUCKET_NUM];
+	uint_fast64_t total, sum, max_value;
+};
+
+//recorded concurrently with relaxed atomic operations, see histogram.
+struct atomic_histogram
+{
+	atomic_histogram() {reset();}
+	void reset()
+	{
+		for (auto& item : buckets)
+			item.store(0, std::memory_order_relaxed);
+		sum.store(0, std::memory_order_relaxed);
+		max_value.store(0, std::memory_order_relaxed);
+	}
+
+	void record(int_fast64_t value)
+	{
+		auto v = histogram::clamp(value);
+		buckets[histogram::index(v)].fetch_add(1, std::memory_order_relaxed);
+		sum.fetch_add(v, std::memory_order_relaxed);
+
+		auto cur_max = max_value.load(std::memory_order_relaxed);
+		while (v > cur_max && !max_value.compare_exchange_weak(cur_max, v, std::memory_order_relaxed))
+			;
+	}
+
+	void add_to(histogram& h) const
+	{
+		for (size_t i = 0; i < histogram::BUCKET_NUM; ++i)
+		{
+			auto num = buckets[i].load(std::memory_order_relaxed);
+			h.buckets[i] += num;
+			h.total += num;
+		}
+		h.sum += sum.load(std::memory_order_relaxed);
+		h.max_value = std::max(h.max_value, (uint_fast64_t) max_value.load(std::memory_order_relaxed));
+	}
+
+	std::atomic_uint_fast64_t buckets[histogram::BUCKET_NUM];
+	std::atomic_uint_fast64_t sum, max_value;
+};
+
+//a snapshot of service_pump's instrumentation, see service_pump::get_loop_statistic.
+struct loop_statistic
+{
+	loop_statistic& operator+=(const loop_statistic& other)
+	{
+		lag += other.lag;
+		send_delay += other.send_delay;
+		dispatch_delay += other.dispatch_delay;
+		handle_time += other.handle_time;
+		busy_time.insert(std::end(busy_time), std::begin(other.busy_time), std::end(other.busy_time));
+
+		return *this;
+	}
+
+	std::string to_string() const
+	{
+		std::ostringstream s;
+		s << "scheduling lag: " << lag.to_string() << std::endl
+			<< "send delay: " << send_delay.to_string() << std::endl
+			<< "dispatch delay: " << dispatch_delay.to_string() << std::endl
+			<< "on_msg_handle duration: " << handle_time.to_string() << std::endl
+			<< "busy time (s):";
+		for (auto& item : busy_time)
+			s << ' ' << std::fixed << std::setprecision(3) << item / 1000000000.0;
+		return s.str();
+	}
+
+	histogram lag; //from posting a probe handler to its execution
+	histogram send_delay; //per message, see statistic::send_delay_sum
+	histogram dispatch_delay; //per message, see statistic::dispatch_delay_sum
+	histogram handle_time; //per on_msg_handle (and on_msg) invocation, see statistic::handle_time_sum
+	std::vector<uint_fast64_t> busy_time; //in nanoseconds, time spent on handlers, one item per thread statistic block
+};
+#endif
+
+//counter block of service thread(s), sockets bump the block of current thread with relaxed atomic operations, see macro ASCS_ATOMIC_STATISTIC for more details.
+struct alignas(64) thread_statistic
+{
+#ifdef ASCS_FULL_STATISTIC
+	typedef std::atomic<statistic::stat_duration::rep> atomic_duration;
+#endif
+	thread_statistic() {reset();}
+
+	void reset()
+	{
+		send_msg_sum.store(0, std::memory_order_relaxed);
+		send_byte_sum.store(0, std::memory_order_relaxed);
+		recv_msg_sum.store(0, std::memory_order_relaxed);
+		recv_byte_sum.store(0, std::memory_order_relaxed);
+#ifdef ASCS_FULL_STATISTIC
+		send_delay_sum.store(0, std::memory_order_relaxed);
+		send_time_sum.store(0, std::memory_order_relaxed);
+		dispatch_delay_sum.store(0, std::memory_order_relaxed);
+		recv_idle_sum.store(0, std::memory_order_relaxed);
+		handle_time_sum.store(0, std::memory_order_relaxed);
+#endif
+#ifdef ASCS_LOOP_MONITOR
+		busy_time.store(0, std::memory_order_relaxed);
+		send_delay_histogram.reset();
+		dispatch_delay_histogram.reset();
+		handle_time_histogram.reset();
+#endif
+	}
+
+	void add_to(struct statistic& stat) const
+	{
+		stat.send_msg_sum += send_msg_sum.load(std::memory_order_relaxed);
+		stat.send_byte_sum += send_byte_sum.load(std::memory_order_relaxed);
+		stat.recv_msg_sum += recv_msg_sum.load(std::memory_order_relaxed);
+		stat.recv_byte_sum += recv_byte_sum.load(std::memory_order_relaxed);
+#ifdef ASCS_FULL_STATISTIC
+		stat.send_delay_sum += statistic::stat_duration(send_delay_sum.load(std::memory_order_relaxed));
+		stat.send_time_sum += statistic::stat_duration(send_time_sum.load(std::memory_order_relaxed));
+		stat.dispatch_delay_sum += statistic::stat_duration(dispatch_delay_sum.load(std::memory_order_relaxed));
+		stat.recv_idle_sum += statistic::stat_duration(recv_idle_sum.load(std::memory_order_relaxed));
+		stat.handle_time_sum += statistic::stat_duration(handle_time_sum.load(std::memory_order_relaxed));
+#endif
+	}
+#ifdef ASCS_LOOP_MONITOR
+	void add_to(loop_statistic& stat) const
+	{
+		send_delay_histogram.add_to(stat.send_delay);
+		dispatch_delay_histogram.add_to(stat.dispatch_delay);
+		handle_time_histogram.add_to(stat.handle_time);
+		stat.busy_time.emplace_back(busy_time.load(std::memory_order_relaxed));
+	}
+#endif
+
+	//service_pump set this for its service threads
+	static thread_statistic*& this_thread() {static thread_local thread_statistic* block = nullptr; return block;}
+	//threads not belong to any service_pump share one block, nobody will sum it up.
+	static thread_statistic& current() {auto block = this_thread(); if (nullptr != block) return *block; static thread_statistic orphan; return orphan;}
+
+	std::atomic_uint_fast64_t send_msg_sum, send_byte_sum;
+	std::atomic_uint_fast64_t recv_msg_sum, recv_byte_sum;
+#ifdef ASCS_FULL_STATISTIC
+	atomic_duration send_delay_sum, send_time_sum;
+	atomic_duration dispatch_delay_sum, recv_idle_sum, handle_time_sum;
+#endif
+#ifdef ASCS_LOOP_MONITOR
+	std::atomic_uint_fast64_t busy_time; //nanoseconds
+	atomic_histogram send_delay_histogram, dispatch_delay_histogram, handle_time_histogram;
+#endif
+};
+
+#define ASCS_THREAD_STAT_ADD(ITEM, VALUE) thread_statistic::current().ITEM.fetch_add(VALUE, std::memory_order_relaxed)
+#ifdef ASCS_FULL_STATISTIC
+#define ASCS_THREAD_STAT_DURATION_ADD(ITEM, VALUE) thread_statistic::current().ITEM.fetch_add((VALUE).count(), std::memory_order_relaxed)
+#else
+#define ASCS_THREAD_STAT_DURATION_ADD(ITEM, VALUE)
+#endif
+#ifdef ASCS_LOOP_MONITOR
+#define ASCS_THREAD_STAT_HISTOGRAM_ADD(ITEM, VALUE) \
+	thread_statistic::current().ITEM.record((int_fast64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(VALUE).count())
+#else
+#define ASCS_THREAD_STAT_HISTOGRAM_ADD(ITEM, VALUE)
+#endif
+#else
+class seq_lock //not a real lock, just satisfy compiler
+{
+public:
+	void lock() {}
+	void unlock() {}
+
+	unsigned read_begin() const {return 0;}
+	bool read_retry(unsigned s) const {return false;}
+};
+
+#define ASCS_THREAD_STAT_ADD(ITEM, VALUE)
+#define ASCS_THREAD_STAT_DURATION_ADD(ITEM, VALUE)
+#define ASCS_THREAD_STAT_HISTOGRAM_ADD(ITEM, VALUE)
+#endif
+
 class auto_duration
 {
 public:
-	auto_duration(statistic::stat_duration& duration_) : started(true), begin_time(statistic::now()), duration(duration_) {}
+	auto_duration(statistic::stat_duration& duration_) : started(true), begin_time(statistic::now()), duration(duration_), lock(nullptr) {}
+	auto_duration(statistic::stat_duration& duration_, seq_lock& lock_) : started(true), begin_time(statistic::now()), duration(duration_), lock(&lock_) {}
 	~auto_duration() {end();}
 
-	void end() {if (started) duration += statistic::now() - begin_time; started = false;}
+	void end()
+	{
+		if (!started)
+			return;
+
+		auto elapsed = statistic::now() - begin_time;
+		if (nullptr != lock)
+		{
+			std::lock_guard<seq_lock> guard(*lock);
+			duration += elapsed;
+		}
+		else
+			duration += elapsed;
+		started = false;
+	}
 
 private:
 	bool started;
 	statistic::stat_time begin_time;
 	statistic::stat_duration& duration;
+	seq_lock* lock;
 };
 
 enum sync_call_result {SUCCESS, NOT_APPLICABLE, DUPLICATE, TIMEOUT};
@@ -603,6 +956,12 @@ template<typename _Predicate> void NAME(const _Predicate& __pred) const {for (au
 TYPE FUNNAME(const char* pstr, size_t len, bool can_overflow) {return FUNNAME(&pstr, &len, 1, can_overflow);} \
 template<typename Buffer> TYPE FUNNAME(const Buffer& buffer, bool can_overflow = false) {return FUNNAME(buffer.data(), buffer.size(), can_overflow);}
 
+#ifdef ASCS_APPEND_SEND_MSG
+#define TCP_APPEND_MSG(NATIVE) if (do_append_msg(pstr, len, num, NATIVE)) return true;
+#else
+#define TCP_APPEND_MSG(NATIVE)
+#endif
+
 #define TCP_SEND_MSG(FUNNAME, NATIVE) \
 bool FUNNAME(in_msg_type&& msg, bool can_overflow = false) \
 { \
@@ -611,7 +970,7 @@ bool FUNNAME(in_msg_type&& msg, bool can_overflow = false) \
 	else if (NATIVE) \
 		return do_direct_send_msg(std::move(msg)); \
 	typename Packer::container_type msg_can; \
-	auto_duration dur(stat.pack_time_sum); \
+	auto_duration dur(stat.pack_time_sum, stat_lock); \
 	auto re = packer_->pack_msg(std::move(msg), msg_can); \
 	dur.end(); \
 	return re ? do_direct_send_msg(msg_can) : FUNNAME(msg, can_overflow); \
@@ -627,7 +986,7 @@ bool FUNNAME(in_msg_type&& msg1, in_msg_type&& msg2, bool can_overflow = false)
 		return true; /*do_direct_send_msg will always succeed*/ \
 	} \
 	typename Packer::container_type msg_can; \
-	auto_duration dur(stat.pack_time_sum); \
+	auto_duration dur(stat.pack_time_sum, stat_lock); \
 	auto re = packer_->pack_msg(std::move(msg1), std::move(msg2), msg_can); \
 	dur.end(); \
 	return re && do_direct_send_msg(msg_can); \
@@ -639,7 +998,7 @@ bool FUNNAME(typename Packer::container_type& msg_can, bool can_overflow = false
 	else if (NATIVE) \
 		return do_direct_send_msg(msg_can); \
 	typename Packer::container_type out; \
-	auto_duration dur(stat.pack_time_sum); \
+	auto_duration dur(stat.pack_time_sum, stat_lock); \
 	auto re = packer_->pack_msg(msg_can, out); \
 	dur.end(); \
 	return re && do_direct_send_msg(out); \
@@ -648,7 +1007,8 @@ bool FUNNAME(const char* const pstr[], const size_t len[], size_t num, bool can_
 { \
 	if (!can_overflow && !this->is_send_buffer_available()) \
 		return false; \
-	auto_duration dur(stat.pack_time_sum); \
+	TCP_APPEND_MSG(NATIVE) \
+	auto_duration dur(stat.pack_time_sum, stat_lock); \
 	auto msg = packer_->pack_msg(pstr, len, num, NATIVE); \
 	dur.end(); \
 	return do_direct_send_msg(std::move(msg)); \
@@ -691,7 +1051,7 @@ sync_call_result FUNNAME(in_msg_type&& msg, unsigned duration = 0, bool can_over
 	else if (NATIVE) \
 		return do_direct_sync_send_msg(std::move(msg), duration); \
 	typename Packer::container_type msg_can; \
-	auto_duration dur(stat.pack_time_sum); \
+	auto_duration dur(stat.pack_time_sum, stat_lock); \
 	auto re = packer_->pack_msg(std::move(msg), msg_can); \
 	dur.end(); \
 	return re ? do_direct_sync_send_msg(msg_can, duration) : FUNNAME(msg, duration, can_overflow); \
@@ -707,7 +1067,7 @@ sync_call_result FUNNAME(in_msg_type&& msg1, in_msg_type&& msg2, unsigned durati
 		return sync_call_result::SUCCESS; /*do_direct_sync_send_msg will always succeed*/ \
 	} \
 	typename Packer::container_type msg_can; \
-	auto_duration dur(stat.pack_time_sum); \
+	auto_duration dur(stat.pack_time_sum, stat_lock); \
 	auto re = packer_->pack_msg(std::move(msg1), std::move(msg2), msg_can); \
 	dur.end(); \
 	return re ? do_direct_sync_send_msg(msg_can, duration) : sync_call_result::NOT_APPLICABLE; \
@@ -719,7 +1079,7 @@ sync_call_result FUNNAME(typename Packer::container_type& msg_can, unsigned dura
 	else if (NATIVE) \
 		return do_direct_sync_send_msg(msg_can, duration); \
 	typename Packer::container_type out; \
-	auto_duration dur(stat.pack_time_sum); \
+	auto_duration dur(stat.pack_time_sum, stat_lock); \
 	auto re = packer_->pack_msg(msg_can, out); \
 	dur.end(); \
 	return re ? do_direct_sync_send_msg(out, duration) : sync_call_result::NOT_APPLICABLE; \
@@ -728,7 +1088,7 @@ sync_call_result FUNNAME(const char* const pstr[], const size_t len[], size_t nu
 { \
 	if (!can_overflow && !this->is_send_buffer_available()) \
 		return sync_call_result::NOT_APPLICABLE; \
-	auto_duration dur(stat.pack_time_sum); \
+	auto_duration dur(stat.pack_time_sum, stat_lock); \
 	auto msg = packer_->pack_msg(pstr, len, num, NATIVE); \
 	dur.end(); \
 	return do_direct_sync_send_msg(std::move(msg), duration); \
@@ -531,6 +531,34 @@
  * Demonstrate how to accept just one client at server endpoint in demo echo_server.
  * Demonstrate how to change local address if the binding was failed (in demo udp_test).
  * Enhance flexibility via rvalue reference and std::forward.
+ * Add macro ASCS_ATOMIC_STATISTIC to support consistent statistic snapshots and lock-free aggregated statistic (per service thread).
+ * Add macro ASCS_USE_TIMING_WHEEL to let timers share a hierarchical timing wheel (per io_context) rather than own an asio timer each.
+ * Timers with small ids (less than ASCS_TIMER_TABLE_SIZE) can be looked up lock-free, and are created on demand, timer status becomes atomic.
+ * Call backs of timers and handlers of async operations (when tracking io_context) no longer allocate memory if they're small enough (see inplace_function).
+ * Add macro ASCS_IO_CONTEXT_PER_THREAD to let service_pump own one io_context per service thread and elide strands.
+ * Add macro ASCS_REUSE_PORT_ACCEPTOR_NUM to let server_base listen on the same endpoint with more than one acceptor (SO_REUSEPORT).
+ * Add macro ASCS_ACCEPT_BATCH_NUM to let server_base accept connections in batch (non-blocking accept after the acceptor becomes readable).
+ * Add macro ASCS_TCP_DEFER_ACCEPT, ASCS_TCP_FASTOPEN and ASCS_TCP_FASTOPEN_CONNECT to support TCP_DEFER_ACCEPT and TCP fast open.
+ * Add macro ASCS_DISPATCH_POOL to let sockets dispatch messages in a work-stealing thread pool rather than in service threads.
+ * Add macro ASCS_AUTO_SCALE_THREAD to let service_pump add or delete service threads according to reactor lag and busy ratio.
+ * Service threads deleted at runtime will be joined when adding new service threads.
+ * Add macro ASCS_LOOP_MONITOR to provide scheduling lag, busy time and latency histograms at service_pump level (see loop_statistic).
+ * Add macro ASCS_BUSY_POLL to let service threads spin on poll() before blocking, and macro ASCS_SO_BUSY_POLL to set SO_BUSY_POLL on sockets.
+ * Add macro ASCS_THREAD_PLACEMENT to pin service threads to CPUs or NUMA nodes, and allocate unpackers on the node of their io_context.
+ * With ASCS_DELAY_CLOSE equal to zero, async calls are tracked by an intrusive counter (padded to its own cache line) instead of std::shared_ptr.
+ * Add macro ASCS_HANDLER_MEMORY to let sockets and timers provide asio with recycled memory for their asynchronous operations.
+ * tcp::socket_base no longer allocates (and lets asio copy) a buffer vector for every sending.
+ * Add macro ASCS_SINGLE_STRAND_SOCKET to let sockets receive, send and dispatch messages in one strand, the receiving buffer becomes non_lock_queue.
+ * Add macro ASCS_SPECULATIVE_SEND to let tcp::socket_base write messages inline (non-blocking) when its sending side is idle.
+ * Add macro ASCS_SPECULATIVE_RECV to let tcp::socket_base read messages inline (non-blocking) for a limited number of times in a row.
+ * Add macro ASCS_SEND_COALESCING to let tcp sockets hold sending for a while (or until enough bytes are waiting) to send small messages in batches.
+ * Add macro ASCS_APPEND_SEND_MSG to let tcp sockets pack small messages into big blocks in the send buffer (see i_packer::append_msg).
+ * Add in-place message building for tcp sockets (prepare_msg and (sync_)(safe_)send_prepared_msg), see i_packer::prepare_msg and i_packer::finalize_msg.
+ * Add macro ASCS_WANT_BATCH_MSG_SEND_NOTIFY to get all messages sent by one write in tcp::socket_base::on_msgs_send.
+ * Add macro ASCS_ZEROCOPY_SEND to let tcp sockets send big writes with MSG_ZEROCOPY (linux only).
+ * Add macro ASCS_IO_URING to run ascs on asio's io_uring backend (linux only).
+ * Add macro ASCS_COARSE_CLOCK to let sockets read a clock refreshed by service_pump rather than call time() on every sending and receiving.
+ * With ASCS_FULL_STATISTIC, durations are measured by std::chrono::steady_clock rather than std::chrono::system_clock.
  *
  * DELETION:
  *
@@ -581,6 +609,11 @@ static_assert(ASIO_VERSION >= 101001, "ascs needs asio 1.10.1 or higher.");
 
 #if ASIO_VERSION < 101100
 namespace asio {typedef io_service io_context;}
+#endif
+
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+#define make_strand_handler(S, F) F //strands are unnecessary since each io_context has only one thread
+#elif ASIO_VERSION < 101100
 #define make_strand_handler(S, F) S.wrap(F)
 #else
 #define make_strand_handler(S, F) asio::bind_executor(S, F)
@@ -634,6 +667,25 @@ static_assert(ASCS_MAX_RECV_BUF > 15, "recv buffer capacity must be bigger than
 //if defined, asio::steady_timer will be used in ascs::timer, otherwise, asio::system_timer will be used.
 //#define ASCS_USE_STEADY_TIMER
 
+//if defined, all ascs::timer objects belong to the same io_context will share one hierarchical timing wheel (see timing_wheel.h) instead of
+// owning an asio timer per timer, then arming and canceling timers are O(1), and asio's timer heap will not be stuffed by a huge number of
+// timers (for example, 100k connections with heartbeat), per timer memory also shrinks a lot. macro ASCS_USE_STEADY_TIMER will be ignored.
+//the cost is precision, durations will be rounded up to the tick of the wheel, which is ASCS_TIMING_WHEEL_TICK by default and can be changed
+// via timing_wheel::tick() (or service_pump::get_timing_wheel().tick()) before any timers been started.
+//#define ASCS_USE_TIMING_WHEEL
+#ifndef ASCS_TIMING_WHEEL_TICK
+#define ASCS_TIMING_WHEEL_TICK	10 //milliseconds
+#endif
+static_assert(ASCS_TIMING_WHEEL_TICK > 0, "the tick of timing wheel must be bigger than zero.");
+
+//timers whose id less than this value will be looked up by index (lock-free) and created on demand (see timer.h), others will be looked up in
+// a list under a mutex, all timers ascs used are in this range, so are yours if you allocate ids from the TIMER_END of your parent class.
+//every timer object costs this many pointers, so don't make it too big.
+#ifndef ASCS_TIMER_TABLE_SIZE
+#define ASCS_TIMER_TABLE_SIZE	32
+#endif
+static_assert(ASCS_TIMER_TABLE_SIZE > 0, "timer table size must be bigger than zero.");
+
 //after this duration, this socket can be freed from the heap or reused,
 //you must define this macro as a value, not just define it, the value means the duration, unit is second.
 //a value equal to zero will cause ascs to use a mechanism to guarantee 100% safety when reusing or freeing this socket,
@@ -645,14 +697,29 @@ static_assert(ASCS_MAX_RECV_BUF > 15, "recv buffer capacity must be bigger than
 static_assert(ASCS_DELAY_CLOSE >= 0, "delay close duration must be bigger than or equal to zero.");
 
 //full statistic include time consumption, or only numerable informations will be gathered
+//durations are measured by std::chrono::steady_clock, so they will not be affected by adjusting the system time.
 //#define ASCS_FULL_STATISTIC
 
+//sockets record last_send_time and last_recv_time (and check heartbeat) via ascs::coarse_clock, which calls time() on every reading by default,
+// define this macro to let service_pump refresh it every ASCS_COARSE_CLOCK milliseconds in a dedicated thread (shared with
+// ASCS_LOOP_MONITOR and ASCS_AUTO_SCALE_THREAD) instead, then reading it is just an atomic load.
+//the unit of these times is second, so the value should be far less than 1000 (the error will be up to ASCS_COARSE_CLOCK milliseconds).
+//while no service_pump is started, reading it falls back to time() (so it will never be frozen).
+//#define ASCS_COARSE_CLOCK	100
+#ifdef ASCS_COARSE_CLOCK
+	static_assert(ASCS_COARSE_CLOCK > 0, "the refreshing interval of coarse clock must be bigger than zero.");
+#endif
+
 //after every msg sent, call ascs::socket::on_msg_send()
 //#define ASCS_WANT_MSG_SEND_NOTIFY
 
 //after sending buffer became empty, call ascs::socket::on_all_msg_send()
 //#define ASCS_WANT_ALL_MSG_SEND_NOTIFY
 
+//after every successful write, call tcp::socket_base::on_msgs_send() with all messages sent by it, unlike ASCS_WANT_MSG_SEND_NOTIFY,
+// this will not limit tcp::socket_base to send only one message per write, so batch sending (gather write) is still available.
+//#define ASCS_WANT_BATCH_MSG_SEND_NOTIFY
+
 //max number of objects object_pool can hold.
 #ifndef ASCS_MAX_OBJECT_NUM
 #define ASCS_MAX_OBJECT_NUM	4096
@@ -742,6 +809,135 @@ static_assert(ASCS_GRACEFUL_SHUTDOWN_MAX_DURATION > 0, "graceful shutdown durati
 #endif
 static_assert(ASCS_ASYNC_ACCEPT_NUM > 0, "async accept number must be bigger than zero.");
 
+//if defined, server_base will open this many acceptors on the same endpoint with SO_REUSEPORT (Linux 3.9 or higher), then the kernel will balance
+// incoming connections among their listen queues, accepting will not be a serialization point any more during connection storms.
+//async accepts (see async_accept_num()) are spread among these acceptors, a new one always goes to the acceptor which has the fewest pending accepts.
+//if ASCS_IO_CONTEXT_PER_THREAD been defined, the acceptors will be put on different io_contexts (round robin), otherwise they share the only one.
+//next_layer() returns the first acceptor, options set on it before start_listen will not affect others.
+//#define ASCS_REUSE_PORT_ACCEPTOR_NUM	4
+#ifdef ASCS_REUSE_PORT_ACCEPTOR_NUM
+	static_assert(ASCS_REUSE_PORT_ACCEPTOR_NUM > 0, "the number of acceptors must be bigger than zero.");
+#endif
+
+//if defined, server_base will not deliver async_accept for each connection, instead, it waits for the acceptor to be readable, then drains
+// the listen queue with non-blocking accept (at most this many connections per round), and only re-arms the async wait after that.
+//this saves a reactor round-trip per connection when many connecting requests flood in. server sockets will be created (or reused) on demand,
+// so async_accept_num() will not be used, and start_next_accept() will not be called after each connection.
+//#define ASCS_ACCEPT_BATCH_NUM	64
+#ifdef ASCS_ACCEPT_BATCH_NUM
+	static_assert(ASIO_VERSION >= 101100, "batch accepting needs asio 1.11 or higher.");
+	static_assert(ASCS_ACCEPT_BATCH_NUM > 0, "the number of connections accepted per batch must be bigger than zero.");
+#endif
+
+//the following three macros are for short connections, they save handshake round-trips or wakeups, only available on Linux.
+//if defined, server_base will set TCP_DEFER_ACCEPT (in seconds) on its acceptor(s), then a connection will not be accepted until its first data
+// arrived (or timed out), this avoids waking up for connections that haven't sent anything yet.
+//#define ASCS_TCP_DEFER_ACCEPT	5
+//if defined, server_base will set TCP_FASTOPEN (the length of the queue of pending TFO requests) on its acceptor(s), clients which support
+// TCP fast open can carry their first data on the SYN (from the second connection, after they got a cookie).
+//#define ASCS_TCP_FASTOPEN	256
+//if defined, tcp::client_socket_base will set TCP_FASTOPEN_CONNECT (Linux 4.11 or higher) before connecting, then the connecting will succeed
+// immediately, and the first message in the send buffer will be carried on the SYN, time-to-first-byte will be reduced by one RTT.
+//please note, with TCP fast open connecting, errors like connection refused will be reported by the first sending/receiving instead of connecting,
+// and on_connect() will be called before the connection is actually established.
+//#define ASCS_TCP_FASTOPEN_CONNECT
+#if defined(ASCS_TCP_DEFER_ACCEPT) || defined(ASCS_TCP_FASTOPEN) || defined(ASCS_TCP_FASTOPEN_CONNECT)
+	#ifndef __linux__
+		#error TCP_DEFER_ACCEPT, TCP_FASTOPEN and TCP_FASTOPEN_CONNECT are only supported on Linux by ascs.
+	#endif
+#endif
+
+//if defined, sockets will set SO_BUSY_POLL (in microseconds) when starting, then the kernel will busy poll the device queue when receiving on an empty
+// socket (once for non-blocking receiving, which is what asio does) instead of waiting for interrupts, only available on Linux, and increasing it
+// needs CAP_NET_ADMIN (failures are reported as warnings only). epoll_wait only busy polls if sysctl net.core.busy_poll is set too.
+//it makes sense with ASCS_BUSY_POLL (and a NIC driver which supports it), loopback is not affected.
+//#define ASCS_SO_BUSY_POLL	50
+#if defined(ASCS_SO_BUSY_POLL) && !defined(__linux__)
+	#error SO_BUSY_POLL is only supported on Linux by ascs.
+#endif
+
+//#define ASCS_IO_URING
+//linux only, run all I/O on asio's io_uring backend instead of epoll, it needs asio 1.21 or newer and liburing (link with -luring, for
+// the examples: make ext_cflag=-DASCS_IO_URING ext_libs=-luring). it defines ASIO_HAS_IO_URING and ASIO_DISABLE_EPOLL before including
+// asio, so it's a compile time choice, asio cannot switch backends at runtime.
+//socket reads and writes become io_uring operations which asio submits in batches (once per run loop iteration), ascs needs no changes
+// for it. but speculative sending and receiving (ASCS_SPECULATIVE_SEND and ASCS_SPECULATIVE_RECV) still try plain syscalls first,
+// please compare with and without them. registered (fixed) buffers are not used, asio only supports them for file and descriptor
+// operations, not for sockets.
+//ascs has not been benchmarked on io_uring against epoll, please measure it with your own workload before switching to it.
+#ifdef ASCS_IO_URING
+	#ifndef __linux__
+		#error ASCS_IO_URING is only available on linux.
+	#elif ASIO_VERSION < 102100
+		#error ASCS_IO_URING needs asio 1.21 or newer.
+	#endif
+#endif
+
+//#define ASCS_SPECULATIVE_SEND
+//if defined, tcp::socket_base will put its socket into non-blocking mode when starting, and when the sending side is idle (no async sending in
+// progress), it writes messages with write_some immediately (in the sending strand, so inline in send_msg if possible, on_msg_handle for
+// example), only the remainder (if any) will be sent asynchronously. if all messages were written, send_handler (and on_msg_send etc.) will be
+// called before send_msg returns, no async operation will be performed, this saves a reactor round-trip and a handler posting for every reply
+// in request/response workloads.
+//the writing is inline only if send_msg can enter the sending strand directly, asio does this when it's called in a service thread and that
+// strand is idle, which is always true with ASCS_SINGLE_STRAND_SOCKET or ASCS_IO_CONTEXT_PER_THREAD (unless on_msg_handle is called by a
+// dispatch_pool). otherwise (by default, with more than one service thread, the sending strand can be busy in another thread; dispatch_pool
+// workers and other threads never run the strand), the sending will be posted to the strand, then the writing is still speculative, only the
+// handler posting is not saved.
+//ssl sockets are not affected.
+
+//#define ASCS_SPECULATIVE_RECV	4
+//if defined, after handling a reading, tcp::socket_base reads the next message into the unpacker's buffer (prepare_next_recv) with non-blocking
+// read_some directly (until the unpacker's completion_condition is satisfied), and handles it immediately if succeeded, rather than going back
+// to the reactor with async_read each time. at most this many speculative readings can be performed in a row, then the socket must do an
+// async reading (which also takes over a partially read message), so a busy socket will not starve others on the same service thread.
+//the buffer returned by prepare_next_recv must be one continuous buffer (the default ASCS_RECV_BUFFER_TYPE).
+//ssl sockets are not affected.
+#ifdef ASCS_SPECULATIVE_RECV
+	static_assert(ASCS_SPECULATIVE_RECV > 0, "the number of speculative readings in a row must be bigger than zero.");
+#endif
+
+//#define ASCS_SEND_COALESCING
+//if defined, tcp::socket_base::coalesce_sending(delay, max_size, cork) will be provided, with it, a socket holds each sending for up to delay
+// microseconds or until max_size bytes are waiting, so a producer which sends many tiny messages will have them sent in a few big batches,
+// optionally with TCP_CORK. it's a per socket and runtime choice, sockets which didn't call it are not affected.
+//the holding is done by an asio::steady_timer which waits in the socket's strand, not by ascs::timer, it will be created when the socket holds
+// its sending for the first time, so sockets which never coalesce pay nothing for it.
+
+//#define ASCS_APPEND_SEND_MSG	65536
+//if defined, tcp sockets will pack a message (sent by send_msg or send_native_msg with buffers, not rvalue messages) into the last message
+// in the send buffer directly if it has not been sent and will not exceed this size (in byte) after packing, so thousands of small messages
+// become a few big blocks, do_send_msg hands asio a handful of large buffers instead of thousands of tiny ones, and packing needs no memory
+// allocation per message any more (except when a block grows).
+//the packer must support it (see i_packer::append_msg, ascs::ext::packer supports it), otherwise messages will be sent one by one as before.
+//if you need sending notifications, use ASCS_WANT_BATCH_MSG_SEND_NOTIFY (blocks rather than messages will be notified).
+#ifdef ASCS_APPEND_SEND_MSG
+	#ifdef ASCS_WANT_MSG_SEND_NOTIFY
+		#error ASCS_APPEND_SEND_MSG cannot be used with ASCS_WANT_MSG_SEND_NOTIFY, because messages in a block cannot be notified separately.
+	#endif
+	static_assert(ASCS_APPEND_SEND_MSG > 0, "the size of message blocks must be bigger than zero.");
+#endif
+
+//#define ASCS_ZEROCOPY_SEND	16384
+//linux (4.14 or newer) only, if defined, tcp sockets (not ssl) will enable SO_ZEROCOPY and send with MSG_ZEROCOPY when a write has at least
+// this many bytes, so big messages will not be copied into the kernel, smaller writes are sent as usual (for them, copying is cheaper than
+// pinning pages and handling the completion).
+//the kernel uses the messages' memory until it reports the completion via the socket's error queue (generally after the peer acknowledged
+// the data), so tcp::socket_base keeps them (and messages sent after them, to keep the order) until then, and only then send notifications
+// (on_msg_send, on_msgs_send and on_all_msg_send) will be called. sync sending (ASCS_SYNC_SEND) still returns after the data was handed
+// to the kernel.
+//if the kernel reports that it copied the data anyway (loopback, or the NIC cannot do scatter-gather for example), zero-copy will be
+// disabled for the rest of this connection.
+//if a write fails after some successful sendings, its messages are kept too, and on_send_error will be called after the kernel released them.
+//when closing, the socket (already shut down) will wait at most ASCS_GRACEFUL_SHUTDOWN_MAX_DURATION seconds for messages being kept, then
+// abort the connection (RST) to let the kernel discard them, and call on_send_error for them (see tcp::socket_base::is_ready_to_close).
+#ifdef ASCS_ZEROCOPY_SEND
+	#ifndef __linux__
+		#error ASCS_ZEROCOPY_SEND is only available on linux.
+	#endif
+	static_assert(ASCS_ZEROCOPY_SEND > 0, "the zero-copy threshold must be bigger than zero.");
+#endif
+
 //in server_base::set_server_addr and set_local_addr, if the IP is empty, ASCS_(TCP/UDP)_DEFAULT_IP_VERSION will define the IP version,
 // or the IP version will be deduced by the IP address.
 //asio::ip::(tcp/udp)::v4() means ipv4 and asio::ip::(tcp/udp)::v6() means ipv6.
@@ -762,7 +958,11 @@ static_assert(ASCS_ASYNC_ACCEPT_NUM > 0, "async accept number must be bigger tha
 #define ASCS_INPUT_CONTAINER list
 #endif
 #ifndef ASCS_OUTPUT_QUEUE
-#define ASCS_OUTPUT_QUEUE lock_queue
+	#ifdef ASCS_SINGLE_STRAND_SOCKET
+	#define ASCS_OUTPUT_QUEUE non_lock_queue
+	#else
+	#define ASCS_OUTPUT_QUEUE lock_queue
+	#endif
 #endif
 #ifndef ASCS_OUTPUT_CONTAINER
 #define ASCS_OUTPUT_CONTAINER list
@@ -771,6 +971,21 @@ static_assert(ASCS_ASYNC_ACCEPT_NUM > 0, "async accept number must be bigger tha
 //'server_socket_base', 'ssl::client_socket_base' and 'ssl::server_socket_base'.
 //we even can let a socket to use different queue (and / or different container) for input and output via template parameters.
 
+//#define ASCS_SINGLE_STRAND_SOCKET
+//by default, a socket dispatches messages in one strand, and receives and sends messages in another (tcp::socket_base's or udp::socket_base's),
+// so a message passes two strands and the locks of both queues. with this macro, receiving, sending and dispatching use the same strand,
+// then sending in on_msg_handle (or on_msg) will be executed immediately rather than been posted to another strand, and the output queue
+// (receiving buffer) is only accessed in that strand, so it becomes non_lock_queue by default (if you didn't define ASCS_OUTPUT_QUEUE).
+//the input queue (sending buffer) still needs a lock, because send_msg can be called in any thread, if you only send messages in the strand
+// (in on_msg_handle, on_msg and other callbacks which are invoked in the strand) or in the only service thread (see ASCS_IO_CONTEXT_PER_THREAD),
+// you can define ASCS_INPUT_QUEUE as non_lock_queue too.
+//the cost is that one socket can no longer receive and dispatch messages in parallel (on different service threads), so this macro suits many
+// connections with light message handling, not few connections with heavy message handling.
+//pop_first_pending_recv_msg and pop_all_pending_recv_msg are not thread safe any more (with the default output queue).
+#if defined(ASCS_SINGLE_STRAND_SOCKET) && defined(ASCS_DISPATCH_POOL)
+	#error ASCS_SINGLE_STRAND_SOCKET cannot be used with ASCS_DISPATCH_POOL.
+#endif
+
 //buffer type used when receiving messages (unpacker's prepare_next_recv() need to return this type)
 #ifndef ASCS_RECV_BUFFER_TYPE
 	#if ASIO_VERSION >= 101100
@@ -807,6 +1022,61 @@ static_assert(ASCS_HEARTBEAT_MAX_ABSENCE > 0, "heartbeat absence must be bigger
 //#define ASCS_DECREASE_THREAD_AT_RUNTIME
 //enable decreasing service thread at runtime.
 
+//#define ASCS_AUTO_SCALE_THREAD
+//let service_pump add or delete service threads automatically (one at a time, every ASCS_AUTO_SCALE_INTERVAL milliseconds) within
+// [min_service_thread_num(), max_service_thread_num()] (see service_pump::auto_scale), decisions are based on two indicators of the last interval:
+// reactor lag, how long a posted probe handler waited before been executed, it grows only if all service threads are busy.
+// busy ratio, time spent on handlers / (interval * thread number), the handler which wakes up an idle thread is not counted.
+//a thread will be added if the busy ratio reaches ASCS_AUTO_SCALE_HIGH_BUSY, or the lag reaches ASCS_AUTO_SCALE_MAX_LAG while the busy ratio
+// is not below ASCS_AUTO_SCALE_LOW_BUSY (a single probe can be delayed by the system even if we're idle), a thread will be deleted
+// if the lag is below half of ASCS_AUTO_SCALE_MAX_LAG and the busy ratio (with one less thread) would still be below ASCS_AUTO_SCALE_LOW_BUSY.
+//the initial thread number is still decided by start_service or run_service, scaling is performed in a dedicated thread (not a service thread).
+#ifdef ASCS_AUTO_SCALE_THREAD
+	#ifndef ASCS_DECREASE_THREAD_AT_RUNTIME
+		#error ASCS_AUTO_SCALE_THREAD needs macro ASCS_DECREASE_THREAD_AT_RUNTIME.
+	#endif
+
+	#ifndef ASCS_MIN_SERVICE_THREAD_NUM
+	#define ASCS_MIN_SERVICE_THREAD_NUM	1
+	#endif
+	#ifndef ASCS_MAX_SERVICE_THREAD_NUM
+	#define ASCS_MAX_SERVICE_THREAD_NUM	(4 * ASCS_SERVICE_THREAD_NUM)
+	#endif
+	static_assert(ASCS_MIN_SERVICE_THREAD_NUM > 0 && ASCS_MAX_SERVICE_THREAD_NUM >= ASCS_MIN_SERVICE_THREAD_NUM, "invalid auto scale bounds.");
+
+	#ifndef ASCS_AUTO_SCALE_INTERVAL
+	#define ASCS_AUTO_SCALE_INTERVAL	1000 //milliseconds
+	#endif
+	static_assert(ASCS_AUTO_SCALE_INTERVAL > 0, "auto scale interval must be bigger than zero.");
+
+	#ifndef ASCS_AUTO_SCALE_MAX_LAG
+	#define ASCS_AUTO_SCALE_MAX_LAG	2000 //microseconds
+	#endif
+	#ifndef ASCS_AUTO_SCALE_HIGH_BUSY
+	#define ASCS_AUTO_SCALE_HIGH_BUSY	80 //percent
+	#endif
+	#ifndef ASCS_AUTO_SCALE_LOW_BUSY
+	#define ASCS_AUTO_SCALE_LOW_BUSY	50 //percent
+	#endif
+	static_assert(ASCS_AUTO_SCALE_LOW_BUSY < ASCS_AUTO_SCALE_HIGH_BUSY, "ASCS_AUTO_SCALE_LOW_BUSY must be less than ASCS_AUTO_SCALE_HIGH_BUSY.");
+#endif
+
+//#define ASCS_IO_CONTEXT_PER_THREAD
+//service_pump will own one io_context per service thread (itself is the first one, the number is decided when constructing service_pump),
+// every io_context is run by one and only one thread, sockets (created by servers, multi_client_base or multi_service_base) will be assigned to
+// an io_context at creation (see service_pump::assign_io_context), all their async operations and handlers stay in that thread, so strands
+// are elided. this avoids the contention on the single reactor queue of one io_context run by many threads, and scales much better on many cores.
+//the thread_num parameter of service_pump::start_service and run_service will be ignored, and service threads cannot be added or deleted at runtime.
+//please note that objects created directly on service_pump (for example, single_client_base, timers, acceptors) use the first io_context.
+//io_contexts except the first one are kept running (by work guards) while service_pump is started, since sockets can be assigned to them at any
+// time, these guards will be released by end_service(), or (without macro ASCS_AVOID_AUTO_STOP_SERVICE) when the first io_context runs out,
+// which means all services (they run on the first io_context) stopped, then each io_context stops after its remaining works finished.
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+	#ifdef ASCS_DECREASE_THREAD_AT_RUNTIME
+		#error ASCS_DECREASE_THREAD_AT_RUNTIME cannot be used with ASCS_IO_CONTEXT_PER_THREAD.
+	#endif
+#endif
+
 #ifndef ASCS_MSG_RESUMING_INTERVAL
 #define ASCS_MSG_RESUMING_INTERVAL	50 //milliseconds
 #endif
@@ -877,6 +1147,16 @@ static_assert(ASCS_MSG_HANDLING_INTERVAL >= 0, "the interval of msg handling mus
 // on_msg (new messages arrived) can be invoked concurrently, please note. as before, on_msg will block the next receiving but only on current socket.
 //if you cannot handle all of the messages in on_msg (like echo_server), you should not use sync message dispatching except you can bear message disordering.
 
+//#define ASCS_DISPATCH_POOL
+//with this macro, socket::set_dispatch_pool(dispatch_pool*) will be provided, after that, on_msg_handle of that socket will be invoked in the
+// work-stealing pool (see dispatch_pool.h) rather than in service threads, so heavy message handling will not delay io of other sockets.
+//messages of one socket are still dispatched in sequence (at most one dispatching task per socket can exist in the pool), on_msg is not affected.
+//if the pool falls behind, the receiving buffer will be filled up and message receiving will be suspended (see is_recv_buffer_available(),
+// msg_resuming_interval() and recv_idle_sum in statistic), that's the backpressure, nothing will be queued limitlessly.
+//the pool must outlive all sockets that use it, and the output queue must be thread safe (the default one is).
+//if the pool is not started or is stopping, messages will be dispatched in service threads, dispatch_pool::stop() executes tasks already in the pool.
+//with macro ASCS_ATOMIC_STATISTIC, start the pool with the service_pump (see dispatch_pool::start) to count its activities in that service_pump.
+
 //if you search or traverse (via do_something_to_all or do_something_to_one) objects in object_pool frequently and shared_mutex is available,
 // use shared_mutex with shared_lock instead of mutex with unique_lock will promote performance, otherwise, do not define these two macros.
 #ifndef ASCS_SHARED_MUTEX_TYPE
@@ -886,6 +1166,123 @@ static_assert(ASCS_MSG_HANDLING_INTERVAL >= 0, "the interval of msg handling mus
 #define ASCS_SHARED_LOCK_TYPE	std::unique_lock
 #endif
 
+//#define ASCS_ATOMIC_STATISTIC
+//protect each socket's statistic with a sequence lock, then socket::get_statistic_snapshot() can return a consistent copy (no torn 64-bit values),
+// writers of the same socket are serialized by a tiny spin lock, readers never block writers.
+//besides, each service thread will own a counter block (aligned to cache line), sockets bump the block of current thread with relaxed
+// atomic operations, then service_pump::get_statistic() can sum up all blocks without taking any locks, this is very useful if you want to
+// monitor a huge number of sockets frequently (object_pool::get_statistic() need to lock the pool and traverse all sockets).
+//if service threads outnumber ASCS_THREAD_STATISTIC_NUM, some of them will share one block (still correct, just with contention).
+#ifdef ASCS_ATOMIC_STATISTIC
+	#if defined(_MSC_VER) && _MSC_VER < 1900
+		#error atomic statistic needs thread_local and alignas.
+	#endif
+	#ifndef ASCS_THREAD_STATISTIC_NUM
+	#define ASCS_THREAD_STATISTIC_NUM	16
+	#endif
+	static_assert(ASCS_THREAD_STATISTIC_NUM > 0, "the number of thread statistic blocks must be bigger than zero.");
+#endif
+
+//#define ASCS_LOOP_MONITOR
+//service_pump level instrumentation, it provides:
+// scheduling lag, a dedicated thread posts a probe handler to each io_context every ASCS_LOOP_MONITOR_INTERVAL milliseconds (if the previous
+//  one has been executed), the time from posting to execution is recorded into a histogram.
+// busy time, service threads execute handlers one by one and measure the time spent on them (the handler which wakes up an idle thread
+//  is not counted), it's accumulated in their thread statistic blocks.
+// HDR style histograms (see ascs::histogram) of send delay, dispatch delay (both per message) and on_msg_handle duration (per invocation),
+//  recorded by sockets into thread statistic blocks, just like the sums in ascs::statistic.
+//call service_pump::get_loop_statistic() to get a snapshot (ascs::loop_statistic), service_pump::reset_statistic() resets them too.
+//this macro needs macro ASCS_ATOMIC_STATISTIC and ASCS_FULL_STATISTIC.
+#ifdef ASCS_LOOP_MONITOR
+	#if !defined(ASCS_ATOMIC_STATISTIC) || !defined(ASCS_FULL_STATISTIC)
+		#error ASCS_LOOP_MONITOR needs macro ASCS_ATOMIC_STATISTIC and ASCS_FULL_STATISTIC.
+	#endif
+	#ifndef ASCS_LOOP_MONITOR_INTERVAL
+	#define ASCS_LOOP_MONITOR_INTERVAL	100 //milliseconds
+	#endif
+	static_assert(ASCS_LOOP_MONITOR_INTERVAL > 0, "loop monitor interval must be bigger than zero.");
+#endif
+
+//#define ASCS_BUSY_POLL
+//low latency mode, designated service threads spin on io_context::poll_one() for ASCS_BUSY_POLL_SPIN microseconds after they became idle
+// before falling back to blocking (io_context::run_one()), so they will not sleep and be waken up between messages which arrive in quick succession.
+//the first ASCS_BUSY_POLL_THREAD_NUM service threads (which started) will spin, and will be pinned to CPUs if a first CPU is specified
+// (Linux only), call service_pump::busy_poll() before start_service() to change these at runtime.
+//please note, a spinning thread will occupy a whole CPU while traffic is continuous, so never let more threads spin than the CPUs you can spare.
+#ifdef ASCS_BUSY_POLL
+	#ifndef ASCS_BUSY_POLL_SPIN
+	#define ASCS_BUSY_POLL_SPIN	50 //microseconds
+	#endif
+	#ifndef ASCS_BUSY_POLL_THREAD_NUM
+	#define ASCS_BUSY_POLL_THREAD_NUM	ASCS_SERVICE_THREAD_NUM
+	#endif
+	static_assert(ASCS_BUSY_POLL_THREAD_NUM >= 0, "the number of busy poll threads must be equal to or bigger than zero.");
+	#ifndef ASCS_BUSY_POLL_FIRST_CPU
+	#define ASCS_BUSY_POLL_FIRST_CPU	-1 //-1 means don't pin, otherwise the Nth spinning thread will be pinned to CPU ASCS_BUSY_POLL_FIRST_CPU + N
+	#endif
+#endif
+
+//#define ASCS_THREAD_PLACEMENT
+//let service_pump pin service threads to an explicit CPU list (service_pump::place_service_threads) or spread them on NUMA nodes
+// (service_pump::spread_service_threads), only available on Linux (the topology is read from sysfs, libnuma is not needed).
+//if all threads which run an io_context are placed on one node (always true with ASCS_IO_CONTEXT_PER_THREAD if placed on nodes or CPUs),
+// sockets running on that io_context will allocate their unpackers (which hold the receive buffers) on that node, see ascs::numa_allocator.
+//messages are allocated by the threads which create them (the unpacker in the service thread for received ones), the system allocates
+// memory on the local node of that thread at first touching (the default policy), so they need nothing but thread placement.
+#if defined(ASCS_THREAD_PLACEMENT) && !defined(__linux__)
+	#error thread placement is only supported on Linux by ascs.
+#endif
+
+//used internally, service threads will be monitored by a dedicated thread (ASCS_AUTO_SCALE_THREAD and ASCS_LOOP_MONITOR).
+#ifdef ASCS_LOOP_MONITOR
+	#define ASCS_MONITOR_SERVICE_THREAD
+	#define ASCS_MONITOR_INTERVAL	ASCS_LOOP_MONITOR_INTERVAL
+#elif defined(ASCS_AUTO_SCALE_THREAD)
+	#define ASCS_MONITOR_SERVICE_THREAD
+	#define ASCS_MONITOR_INTERVAL	ASCS_AUTO_SCALE_INTERVAL
+#endif
+//used internally, a dedicated thread ticks every ASCS_TICK_INTERVAL milliseconds to monitor service threads and (or) refresh the coarse clock.
+#if defined(ASCS_MONITOR_SERVICE_THREAD) && defined(ASCS_COARSE_CLOCK)
+	#define ASCS_TICK_THREAD
+	#define ASCS_TICK_INTERVAL	(ASCS_COARSE_CLOCK < ASCS_MONITOR_INTERVAL ? ASCS_COARSE_CLOCK : ASCS_MONITOR_INTERVAL)
+#elif defined(ASCS_MONITOR_SERVICE_THREAD)
+	#define ASCS_TICK_THREAD
+	#define ASCS_TICK_INTERVAL	ASCS_MONITOR_INTERVAL
+#elif defined(ASCS_COARSE_CLOCK)
+	#define ASCS_TICK_THREAD
+	#define ASCS_TICK_INTERVAL	ASCS_COARSE_CLOCK
+#endif
+//used internally, service threads execute handlers one by one (rather than io_context::run()) to measure or spin.
+#if defined(ASCS_MONITOR_SERVICE_THREAD) || defined(ASCS_BUSY_POLL)
+	#define ASCS_STEP_SERVICE_THREAD
+#endif
+
+//#define ASCS_HANDLER_MEMORY
+//if defined, sockets and timers will provide asio with recycled memory (see ascs::handler_memory) for their asynchronous operations (reading,
+// writing, message dispatching and timer waiting), so these operations need no heap allocation inside asio at steady state.
+//each socket owns two blocks of ASCS_HANDLER_MEMORY_SIZE bytes (reading and writing, tcp writing operation holds up to 64 buffers), and one block
+// of ASCS_SMALL_HANDLER_MEMORY_SIZE bytes (message dispatching), each timer (or the timing wheel if ASCS_USE_TIMING_WHEEL been defined) owns one
+// block of ASCS_SMALL_HANDLER_MEMORY_SIZE bytes.
+//bigger operations (depending on the platform, asio version and sizes of handlers) will fall back to the heap silently, so do overlapped ones,
+// for example, re-starting a timer which is still waiting leaves the canceled waiting (not yet completed) and the new one outstanding.
+//see demo alloc_test for how many allocations left per echo round trip.
+#ifdef ASCS_HANDLER_MEMORY
+	#ifndef ASCS_HANDLER_MEMORY_SIZE
+	#define ASCS_HANDLER_MEMORY_SIZE	1024
+	#endif
+	#ifndef ASCS_SMALL_HANDLER_MEMORY_SIZE
+	#define ASCS_SMALL_HANDLER_MEMORY_SIZE	256
+	#endif
+#endif
+
+//call backs of timers and handlers of async operations (the latter only when asio::io_context tracking is enabled, see ASCS_DELAY_CLOSE) are
+// stored in ascs::inplace_function, callable objects not bigger than this value will be stored inside it, others will be allocated on the heap.
+//all call backs ascs used are in this range (on 64 bit platforms), please make your own call backs (captures of lambda) small too.
+#ifndef ASCS_INPLACE_FUNCTION_SIZE
+#define ASCS_INPLACE_FUNCTION_SIZE	48
+#endif
+static_assert(ASCS_INPLACE_FUNCTION_SIZE >= sizeof(void*), "inplace function must be able to hold at least one pointer.");
+
 //configurations
 
 #endif /* _ASCS_CONFIG_H_ */
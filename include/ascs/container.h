@@ -92,6 +92,7 @@ public:
 	void move_items_out(size_t max_size_in_byte, Container& dest) {typename Lockable::lock_guard lock(*this); move_items_out_(max_size_in_byte, dest);}
 	template<typename _Predicate> void do_something_to_all(const _Predicate& __pred) {typename Lockable::lock_guard lock(*this); do_something_to_all_(__pred);}
 	template<typename _Predicate> void do_something_to_one(const _Predicate& __pred) {typename Lockable::lock_guard lock(*this); do_something_to_one_(__pred);}
+	template<typename _Predicate> size_t append_to_back(const _Predicate& __pred) {typename Lockable::lock_guard lock(*this); return append_to_back_(__pred);}
 	//thread safe
 
 	//not thread safe
@@ -174,6 +175,10 @@ public:
 	void do_something_to_one_(const _Predicate& __pred) {for (auto iter = this->begin(); iter != this->end(); ++iter) if (__pred(*iter)) break;}
 	template<typename _Predicate>
 	void do_something_to_one_(const _Predicate& __pred) const {for (auto iter = this->begin(); iter != this->end(); ++iter) if (__pred(*iter)) break;}
+
+	//__pred appends something to the last item and returns the size (in byte) it appended
+	template<typename _Predicate>
+	size_t append_to_back_(const _Predicate& __pred) {if (this->empty()) return 0; auto s = __pred(this->back()); buff_size += s; return s;}
 	//not thread safe
 
 private:
@@ -0,0 +1,213 @@
+/*
+ * dispatch_pool.h
+ *
+ * work-stealing thread pool, sockets can hand their message dispatching (on_msg_handle) over to it,
+ * so heavy message handling will not occupy service threads (which should only do io).
+ */
+
+#ifndef _ASCS_DISPATCH_POOL_H_
+#define _ASCS_DISPATCH_POOL_H_
+
+#include <deque>
+#include <condition_variable>
+
+#include "executor.h"
+#include "service_pump.h"
+
+namespace ascs
+{
+
+//every worker owns a task queue, tasks posted from a worker go to its own queue, others are distributed in round robin,
+// an idle worker takes tasks from the front of its own queue, and then steals from the back of other workers' queues.
+//the pool doesn't guarantee any order between tasks, socket::dispatch_msg keeps at most one task in the pool per socket,
+// which is how messages of the same socket keep their sequence.
+//post() fails if the pool is not started or is stopping, then sockets dispatch messages in service threads instead.
+class dispatch_pool : public asio::noncopyable
+{
+public:
+#if ASIO_VERSION >= 101100 //move-only handlers are supported
+	typedef inplace_function<void()> task_type;
+#else
+	typedef std::function<void()> task_type;
+#endif
+
+	dispatch_pool() : started_(false), stopped_(true), quitting(false), posting(0), pending(0), sleepers(0), next_queue(0) {}
+	~dispatch_pool() {stop();}
+
+	//not thread safe.
+	//with macro ASCS_ATOMIC_STATISTIC, pass the service_pump whose sockets use this pool, then statistic gathered in worker threads (dispatch delay,
+	// handle time and their histograms) will be counted in service_pump::get_statistic() and get_loop_statistic().
+	bool start(int thread_num = ASCS_SERVICE_THREAD_NUM, service_pump* service_pump_ = nullptr)
+	{
+		if (started_ || thread_num <= 0)
+			return false;
+
+		quitting = false;
+		for (auto i = 0; i < thread_num; ++i)
+			queues.emplace_back(new worker_queue);
+		for (auto i = 0; i < thread_num; ++i)
+#ifdef ASCS_ATOMIC_STATISTIC
+			workers.emplace_back([this, i, service_pump_]() {
+				thread_statistic::this_thread() = nullptr == service_pump_ ? nullptr : &service_pump_->next_statistic_block();
+				this->run((size_t) i);
+				thread_statistic::this_thread() = nullptr;
+			});
+#else
+			workers.emplace_back([this, i]() {this->run((size_t) i);});
+		(void) service_pump_;
+#endif
+
+		stopped_ = false; //accept tasks
+		return (started_ = true);
+	}
+
+	//not thread safe, and must not be called in this pool's worker threads (other pools' workers are fine).
+	//tasks already in the pool will be executed before it returns (so sockets will not lose their dispatching), new tasks will be rejected.
+	void stop()
+	{
+		if (!started_)
+			return;
+		else if (this == this_worker().first)
+		{
+			unified_out::error_out("dispatch_pool cannot be stopped in its worker threads.");
+			return;
+		}
+
+		stopped_ = true;
+		while (posting > 0) //wait for posters who saw the pool is running
+			std::this_thread::yield();
+
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+			quitting = true;
+			sleep_cv.notify_all();
+		}
+		for (auto& item : workers)
+			item.join(); //each worker quits after its own queue became empty
+
+		//tasks left in other queues (can only be stolen by try_lock), execute them here
+		task_type task;
+		for (size_t i = 0; i < queues.size(); ++i)
+			while (try_pop(i, task))
+			{
+				task();
+				task = task_type();
+			}
+
+		workers.clear();
+		queues.clear();
+		started_ = false;
+	}
+
+	bool started() const {return started_;}
+	size_t size() const {return queues.size();} //worker number
+	size_t pending_tasks() const {return pending;}
+
+	//return false if the pool is not started or is stopping, the task will not be executed.
+	bool post(task_type&& task)
+	{
+		++posting;
+		if (stopped_) //posting and stopped_ are sequentially consistent, so either stop() waits for us or we see stopped_
+		{
+			--posting;
+			return false;
+		}
+
+		auto& me = this_worker();
+		auto& q = *queues[this == me.first ? me.second : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+		{
+			std::lock_guard<std::mutex> lock(q.mutex);
+			q.tasks.emplace_back(std::move(task));
+		}
+
+		++pending;
+		if (sleepers > 0) //pending and sleepers are sequentially consistent, so either the sleeper sees the new task or we see the sleeper
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+			sleep_cv.notify_one();
+		}
+
+		--posting;
+		return true;
+	}
+
+private:
+	struct worker_queue
+	{
+		std::mutex mutex;
+		std::deque<task_type> tasks;
+	};
+
+	static std::pair<const dispatch_pool*, size_t>& this_worker()
+		{static thread_local std::pair<const dispatch_pool*, size_t> worker((const dispatch_pool*) nullptr, 0); return worker;}
+
+	bool try_pop(size_t index, task_type& task)
+	{
+		for (size_t i = 0; i < queues.size(); ++i)
+		{
+			auto& q = *queues[(index + i) % queues.size()];
+			std::unique_lock<std::mutex> lock(q.mutex, std::defer_lock);
+			if (0 == i)
+				lock.lock();
+			else if (!lock.try_lock()) //never wait for a victim
+				continue;
+
+			if (q.tasks.empty())
+				continue;
+			else if (0 == i)
+			{
+				task = std::move(q.tasks.front());
+				q.tasks.pop_front();
+			}
+			else
+			{
+				task = std::move(q.tasks.back());
+				q.tasks.pop_back();
+			}
+
+			--pending;
+			return true;
+		}
+
+		return false;
+	}
+
+	void run(size_t index)
+	{
+		this_worker() = std::make_pair(this, index);
+
+		task_type task;
+		while (true)
+			if (try_pop(index, task))
+			{
+				task();
+				task = task_type(); //release the task (and the socket it references) as soon as possible
+			}
+			else if (quitting) //no new tasks after quitting been set, see stop()
+				break;
+			else
+			{
+				std::unique_lock<std::mutex> lock(sleep_mutex);
+				++sleepers;
+				sleep_cv.wait(lock, [this]() {return this->quitting || this->pending > 0;});
+				--sleepers;
+			}
+
+		this_worker() = std::make_pair((const dispatch_pool*) nullptr, (size_t) 0);
+	}
+
+private:
+	bool started_;
+	std::atomic_bool stopped_, quitting;
+	std::atomic_size_t posting, pending, sleepers, next_queue;
+
+	std::vector<std::unique_ptr<worker_queue>> queues;
+	std::list<std::thread> workers;
+
+	std::mutex sleep_mutex;
+	std::condition_variable sleep_cv;
+};
+
+} //namespace
+
+#endif /* _ASCS_DISPATCH_POOL_H_ */
@@ -14,6 +14,10 @@
 #define _ASCS_EXECUTOR_H_
 
 #include <functional>
+#include <type_traits>
+#ifdef ASCS_HANDLER_MEMORY
+#include <atomic>
+#endif
 
 #include <asio.hpp>
 
@@ -22,6 +26,186 @@
 namespace ascs
 {
 
+#ifdef ASCS_IO_CONTEXT_PER_THREAD //one and only one thread per io_context, strands are unnecessary
+#if ASIO_VERSION >= 101100
+#define ELIDED_STRAND_FUNCTIONS \
+template<typename F> void post_strand(asio::io_context::strand&, F&& handler) {this->post(std::forward<F>(handler));} \
+template<typename F> void defer_strand(asio::io_context::strand&, F&& handler) {this->defer(std::forward<F>(handler));} \
+template<typename F> void dispatch_strand(asio::io_context::strand&, F&& handler) {this->dispatch(std::forward<F>(handler));}
+#else
+#define ELIDED_STRAND_FUNCTIONS \
+template<typename F> void post_strand(asio::io_context::strand&, F&& handler) {this->post(std::forward<F>(handler));} \
+template<typename F> void dispatch_strand(asio::io_context::strand&, F&& handler) {this->dispatch(std::forward<F>(handler));}
+#endif
+#endif
+
+//a move-only std::function, callable objects not bigger than Capacity (and nothrow move constructible) will be stored inside it,
+// others will be allocated on the heap. used by timers and tracked_executor, so re-arming a timer or starting an async operation will not
+// allocate memory for the call back.
+template<typename Signature, size_t Capacity = ASCS_INPLACE_FUNCTION_SIZE> class inplace_function;
+template<typename R, typename... Args, size_t Capacity> class inplace_function<R(Args...), Capacity>
+{
+private:
+	typedef typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type storage_type;
+	struct vtable
+	{
+		R (*invoke)(void*, Args&&...);
+		void (*move)(void*, void*); //move construct the destination from the source, then destroy the source
+		void (*destroy)(void*);
+	};
+
+	template<typename F> struct inplace_ops
+	{
+		static R invoke(void* buff, Args&&... args) {return (*static_cast<F*>(buff))(std::forward<Args>(args)...);}
+		static void move(void* dst, void* src) {new (dst) F(std::move(*static_cast<F*>(src))); static_cast<F*>(src)->~F();}
+		static void destroy(void* buff) {static_cast<F*>(buff)->~F();}
+		static const vtable* get() {static const vtable table = {&invoke, &move, &destroy}; return &table;}
+	};
+
+	template<typename F> struct heap_ops
+	{
+		static F*& ptr(void* buff) {return *static_cast<F**>(buff);}
+		static R invoke(void* buff, Args&&... args) {return (*ptr(buff))(std::forward<Args>(args)...);}
+		static void move(void* dst, void* src) {ptr(dst) = ptr(src);}
+		static void destroy(void* buff) {delete ptr(buff);}
+		static const vtable* get() {static const vtable table = {&invoke, &move, &destroy}; return &table;}
+	};
+
+	template<typename F> static bool is_null(const F&) {return false;}
+	template<typename T> static bool is_null(T* f) {return nullptr == f;}
+	template<typename T> static bool is_null(const std::function<T>& f) {return !f;}
+
+public:
+	inplace_function() : ops(nullptr) {}
+	inplace_function(std::nullptr_t) : ops(nullptr) {}
+	template<typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, inplace_function>::value>::type>
+	inplace_function(F&& f) : ops(nullptr) {assign(std::forward<F>(f));}
+	inplace_function(inplace_function&& other) : ops(other.ops) {if (nullptr != ops) {ops->move(&buff, &other.buff); other.ops = nullptr;}}
+	~inplace_function() {clear();}
+
+	inplace_function& operator=(inplace_function&& other)
+	{
+		if (this != &other)
+		{
+			clear();
+			if (nullptr != other.ops)
+			{
+				other.ops->move(&buff, &other.buff);
+				ops = other.ops;
+				other.ops = nullptr;
+			}
+		}
+
+		return *this;
+	}
+	inplace_function& operator=(std::nullptr_t) {clear(); return *this;}
+
+	void swap(inplace_function& other) {if (this != &other) {inplace_function tmp(std::move(other)); other = std::move(*this); *this = std::move(tmp);}}
+	void clear() {if (nullptr != ops) {ops->destroy(&buff); ops = nullptr;}}
+	explicit operator bool() const {return nullptr != ops;}
+
+	R operator()(Args... args) const {return ops->invoke(const_cast<storage_type*>(&buff), std::forward<Args>(args)...);}
+
+private:
+	template<typename F> void assign(F&& f)
+	{
+		if (is_null(f))
+			return;
+
+		typedef typename std::decay<F>::type functor;
+		assign<functor>(std::forward<F>(f), std::integral_constant<bool, sizeof(functor) <= Capacity &&
+			alignof(functor) <= alignof(storage_type) && std::is_nothrow_move_constructible<functor>::value>());
+	}
+	template<typename T, typename F> void assign(F&& f, std::true_type) {new (&buff) T(std::forward<F>(f)); ops = inplace_ops<T>::get();}
+	template<typename T, typename F> void assign(F&& f, std::false_type) {heap_ops<T>::ptr(&buff) = new T(std::forward<F>(f)); ops = heap_ops<T>::get();}
+
+	inplace_function(const inplace_function&);
+	inplace_function& operator=(const inplace_function&);
+
+private:
+	const vtable* ops;
+	storage_type buff;
+};
+
+#ifdef ASCS_HANDLER_MEMORY
+//a memory block for one asynchronous operation at a time, asio allocates its operation objects (which hold the handler) from it via
+// handler_allocator, so operations which never overlap (like reading of a socket) need no heap allocation at steady state.
+//requests bigger than Size, or made while the block is in use (overlapped operations), fall back to operator new.
+template<size_t Size = ASCS_HANDLER_MEMORY_SIZE> class handler_memory : public asio::noncopyable
+{
+public:
+	handler_memory() : in_use(false) {}
+
+	void* allocate(size_t size)
+	{
+		if (size <= Size && !in_use.exchange(true, std::memory_order_acquire))
+			return &storage;
+
+		return ::operator new(size);
+	}
+
+	void deallocate(void* p)
+	{
+		if (p == &storage)
+			in_use.store(false, std::memory_order_release);
+		else
+			::operator delete(p);
+	}
+
+private:
+	typename std::aligned_storage<Size>::type storage;
+	std::atomic_bool in_use;
+};
+
+template<typename T, size_t Size = ASCS_HANDLER_MEMORY_SIZE> class handler_allocator
+{
+public:
+	typedef T value_type;
+	template<typename U> struct rebind {typedef handler_allocator<U, Size> other;};
+
+	explicit handler_allocator(handler_memory<Size>& memory_) : memory(memory_) {}
+	template<typename U> handler_allocator(const handler_allocator<U, Size>& other) : memory(other.memory) {}
+
+	T* allocate(size_t n) {return static_cast<T*>(memory.allocate(sizeof(T) * n));}
+	void deallocate(T* p, size_t) {memory.deallocate(p);}
+
+	template<typename U> bool operator==(const handler_allocator<U, Size>& other) const {return &memory == &other.memory;}
+	template<typename U> bool operator!=(const handler_allocator<U, Size>& other) const {return &memory != &other.memory;}
+
+private:
+	template<typename, size_t> friend class handler_allocator;
+	handler_memory<Size>& memory;
+};
+
+//associates handler_memory with a handler, wrap it before binding an executor (make_strand_handler).
+template<typename Handler, size_t Size = ASCS_HANDLER_MEMORY_SIZE> class allocated_handler
+{
+public:
+	typedef handler_allocator<Handler, Size> allocator_type;
+
+	template<typename H> allocated_handler(handler_memory<Size>& memory_, H&& handler_) : memory(memory_), handler(std::forward<H>(handler_)) {}
+	allocator_type get_allocator() const {return allocator_type(memory);}
+
+	template<typename... Args> void operator()(Args&&... args) {handler(std::forward<Args>(args)...);}
+
+#if ASIO_VERSION < 101100 //associated allocator is not supported
+	friend void* asio_handler_allocate(size_t size, allocated_handler* this_handler) {return this_handler->memory.allocate(size);}
+	friend void asio_handler_deallocate(void* p, size_t, allocated_handler* this_handler) {this_handler->memory.deallocate(p);}
+#endif
+
+private:
+	handler_memory<Size>& memory;
+	Handler handler;
+};
+
+template<size_t Size, typename Handler> inline allocated_handler<typename std::decay<Handler>::type, Size> make_allocated_handler(handler_memory<Size>& memory, Handler&& handler)
+	{return allocated_handler<typename std::decay<Handler>::type, Size>(memory, std::forward<Handler>(handler));}
+
+#define make_memory_handler(M, F) ascs::make_allocated_handler(M, F)
+#else
+#define make_memory_handler(M, F) F
+#endif
+
 class executor
 {
 protected:
@@ -35,16 +219,24 @@ public:
 	template<typename F> void post(F&& handler) {asio::post(io_context_, std::forward<F>(handler));}
 	template<typename F> void defer(F&& handler) {asio::defer(io_context_, std::forward<F>(handler));}
 	template<typename F> void dispatch(F&& handler) {asio::dispatch(io_context_, std::forward<F>(handler));}
+#ifndef ASCS_IO_CONTEXT_PER_THREAD
 	template<typename F> void post_strand(asio::io_context::strand& strand, F&& handler) {asio::post(strand, std::forward<F>(handler));}
 	template<typename F> void defer_strand(asio::io_context::strand& strand, F&& handler) {asio::defer(strand, std::forward<F>(handler));}
 	template<typename F> void dispatch_strand(asio::io_context::strand& strand, F&& handler) {asio::dispatch(strand, std::forward<F>(handler));}
+#endif
 #else
 	template<typename F> void post(F&& handler) {io_context_.post(std::forward<F>(handler));}
 	template<typename F> void dispatch(F&& handler) {io_context_.dispatch(std::forward<F>(handler));}
+#ifndef ASCS_IO_CONTEXT_PER_THREAD
 	template<typename F> void post_strand(asio::io_context::strand& strand, F&& handler) {strand.post(std::forward<F>(handler));}
 	template<typename F> void dispatch_strand(asio::io_context::strand& strand, F&& handler) {strand.dispatch(std::forward<F>(handler));}
 #endif
+#endif
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+	ELIDED_STRAND_FUNCTIONS
+#endif
 
+	template<typename F> inline F&& make_handler(F&& f) const {return std::forward<F>(f);}
 	template<typename F> inline F&& make_handler_error(F&& f) const {return std::forward<F>(f);}
 	template<typename F> inline F&& make_handler_error_size(F&& f) const {return std::forward<F>(f);}
 
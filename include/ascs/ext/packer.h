@@ -65,32 +65,37 @@ public:
 	virtual msg_type pack_msg(const char* const pstr[], const size_t len[], size_t num, bool native = false)
 	{
 		msg_type msg;
+		append_msg(msg, pstr, len, num, native);
+		return msg;
+	}
+	virtual bool append_msg(msg_type& msg, const char* const pstr[], const size_t len[], size_t num, bool native = false)
+	{
 		auto pre_len = native ? 0 : ASCS_HEAD_LEN;
 		auto total_len = packer_helper::msg_size_check(pre_len, pstr, len, num);
-		if ((size_t) -1 != total_len && total_len > pre_len)
+		if ((size_t) -1 == total_len || total_len <= pre_len)
+			return false;
+		else if (!native)
 		{
-			if (!native)
+			auto head_len = (ASCS_HEAD_TYPE) total_len;
+			if (total_len != head_len)
 			{
-				auto head_len = (ASCS_HEAD_TYPE) total_len;
-				if (total_len != head_len)
-				{
-					unified_out::error_out("pack msg error: length exceeded the header's range!");
-					return msg;
-				}
-
-				head_len = ASCS_HEAD_H2N(head_len);
-				msg.reserve(total_len);
-				msg.append((const char*) &head_len, ASCS_HEAD_LEN);
+				unified_out::error_out("pack msg error: length exceeded the header's range!");
+				return false;
 			}
-			else
+
+			head_len = ASCS_HEAD_H2N(head_len);
+			if (msg.empty()) //otherwise, let the block grow exponentially
 				msg.reserve(total_len);
+			msg.append((const char*) &head_len, ASCS_HEAD_LEN);
+		}
+		else if (msg.empty())
+			msg.reserve(total_len);
 
-			for (size_t i = 0; i < num; ++i)
-				if (nullptr != pstr[i])
-					msg.append(pstr[i], len[i]);
-		} //if (total_len > pre_len)
+		for (size_t i = 0; i < num; ++i)
+			if (nullptr != pstr[i])
+				msg.append(pstr[i], len[i]);
 
-		return msg;
+		return true;
 	}
 	virtual bool pack_msg(msg_type&& msg, container_type& msg_can)
 	{
@@ -130,6 +135,27 @@ public:
 		return true;
 	}
 	virtual msg_type pack_heartbeat() {auto head_len = packer_helper::pack_header(0); return msg_type((const char*) &head_len, ASCS_HEAD_LEN);}
+	virtual msg_type prepare_msg(size_t body_len = 0)
+	{
+		msg_type msg;
+		msg.reserve(ASCS_HEAD_LEN + std::min(body_len, get_max_msg_size()));
+		msg.resize(ASCS_HEAD_LEN);
+		return msg;
+	}
+	virtual bool finalize_msg(msg_type& msg)
+	{
+		if (msg.size() <= ASCS_HEAD_LEN) //empty body (or prepare_msg was not used), just like pack_msg
+			return false;
+		else if (msg.size() > ASCS_MSG_BUFFER_SIZE)
+		{
+			unified_out::error_out("pack msg error: length exceeded the ASCS_MSG_BUFFER_SIZE!");
+			return false;
+		}
+
+		auto head_len = packer_helper::pack_header(msg.size() - ASCS_HEAD_LEN);
+		memcpy(&msg.front(), &head_len, ASCS_HEAD_LEN);
+		return true;
+	}
 
 	//do not use following helper functions for heartbeat messages.
 	virtual char* raw_data(msg_type& msg) const {return const_cast<char*>(std::next(msg.data(), ASCS_HEAD_LEN));}
@@ -0,0 +1,224 @@
+/*
+ * numa.h
+ *
+ * CPU affinity and NUMA helpers (Linux only), used by service_pump to place service threads, and by sockets to allocate their
+ * buffers on the node of the thread which runs them.
+ * libnuma is not needed, the topology is read from sysfs, and memory policies are set via the mbind system call directly.
+ */
+
+#ifndef _ASCS_NUMA_H_
+#define _ASCS_NUMA_H_
+
+#include <fstream>
+#include <sstream>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "base.h"
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED	1 //old C libraries don't define it
+#endif
+
+namespace ascs
+{
+
+class numa
+{
+public:
+	//cpu list format in sysfs, like 0-3,8-11
+	static std::vector<int> parse_cpu_list(const std::string& list)
+	{
+		std::vector<int> re;
+		std::stringstream ss(list);
+		for (std::string item; std::getline(ss, item, ',');)
+		{
+			auto pos = item.find('-');
+			auto first = atoi(item.data()), last = std::string::npos == pos ? first : atoi(item.data() + pos + 1);
+			for (auto i = first; i <= last; ++i)
+				re.push_back(i);
+		}
+
+		return re;
+	}
+
+	static std::vector<int> online_nodes()
+	{
+		auto re = parse_cpu_list(read_line("/sys/devices/system/node/online"));
+		if (re.empty())
+			re.push_back(0); //kernel without NUMA support, treat it as one node
+		return re;
+	}
+
+	static std::vector<int> node_cpus(int node)
+	{
+		char path[64];
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+		auto re = parse_cpu_list(read_line(path));
+		if (re.empty() && 0 == node) //kernel without NUMA support
+			for (auto i = 0; i < (int) std::thread::hardware_concurrency(); ++i)
+				re.push_back(i);
+		return re;
+	}
+
+	//-1 means unknown
+	static int cpu_node(int cpu)
+	{
+		for (auto node : online_nodes())
+		{
+			auto cpus = node_cpus(node);
+			if (std::find(std::begin(cpus), std::end(cpus), cpu) != std::end(cpus))
+				return node;
+		}
+
+		return -1;
+	}
+
+	//the node all the cpus belong to, -1 means they belong to different nodes (or unknown)
+	static int cpus_node(const std::vector<int>& cpus)
+	{
+		auto re = -1;
+		for (auto cpu : cpus)
+		{
+			auto node = cpu_node(cpu);
+			if (node < 0 || (re >= 0 && node != re))
+				return -1;
+
+			re = node;
+		}
+
+		return re;
+	}
+
+	static bool pin_this_thread(const std::vector<int>& cpus)
+	{
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		for (auto cpu : cpus)
+			if (cpu >= 0 && cpu < CPU_SETSIZE)
+				CPU_SET(cpu, &cpu_set);
+
+		auto re = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+		if (0 == re)
+			return true;
+
+		unified_out::warning_out("cannot pin thread to CPU %s: %s", cpu_list_to_string(cpus).data(), std::system_category().message(re).data());
+		return false;
+	}
+
+	//memory will be allocated on node when it's touched at the first time (if the node has free memory, otherwise on other nodes),
+	// addr and len must be page aligned.
+	static bool prefer_node(void* addr, size_t len, int node)
+	{
+		const auto bits = 8 * sizeof(unsigned long);
+		std::vector<unsigned long> node_mask(node / bits + 1, 0);
+		node_mask[node / bits] = 1UL << (node % bits);
+		if (0 == syscall(SYS_mbind, addr, len, MPOL_PREFERRED, node_mask.data(), node_mask.size() * bits + 1, 0))
+			return true;
+
+		unified_out::warning_out("cannot bind memory to node %d: %s", node, std::system_category().message(errno).data());
+		return false;
+	}
+
+	static size_t page_size() {static const auto size = (size_t) sysconf(_SC_PAGESIZE); return size;}
+
+	static std::string cpu_list_to_string(const std::vector<int>& cpus)
+	{
+		std::string re;
+		for (auto cpu : cpus)
+		{
+			if (!re.empty())
+				re += ',';
+			re += std::to_string(cpu);
+		}
+
+		return re;
+	}
+
+private:
+	static std::string read_line(const char* path)
+	{
+		std::string re;
+		std::ifstream file(path);
+		if (file)
+			std::getline(file, re);
+
+		return re;
+	}
+};
+
+//allocate memory on the specified node (whole pages, so only use it for big objects), -1 means the default policy (operator new).
+template<typename T> class numa_allocator
+{
+public:
+	typedef T value_type;
+	template<typename U> struct rebind {typedef numa_allocator<U> other;};
+
+	numa_allocator(int node_ = -1) : node(node_) {}
+	template<typename U> numa_allocator(const numa_allocator<U>& other) : node(other.get_node()) {}
+
+	int get_node() const {return node;}
+
+	T* allocate(size_t n)
+	{
+		if (node < 0)
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+
+		auto len = aligned_size(n);
+		auto p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (MAP_FAILED == p)
+			throw std::bad_alloc();
+
+		numa::prefer_node(p, len, node); //not fatal
+		return static_cast<T*>(p);
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		if (node < 0)
+			::operator delete(p);
+		else
+			munmap(p, aligned_size(n));
+	}
+
+	template<typename U> bool operator==(const numa_allocator<U>& other) const {return node == other.get_node();}
+	template<typename U> bool operator!=(const numa_allocator<U>& other) const {return node != other.get_node();}
+
+private:
+	static size_t aligned_size(size_t n) {return (n * sizeof(T) + numa::page_size() - 1) / numa::page_size() * numa::page_size();}
+
+private:
+	int node;
+};
+
+//which node an io_context's service threads run on, -1 means unknown or more than one node, see service_pump::place_service_threads.
+template<typename Dummy = void> class basic_io_context_node : public asio::io_context::service
+{
+public:
+	static asio::io_context::id id;
+
+	basic_io_context_node(asio::io_context& io_context_) : asio::io_context::service(io_context_), node(-1) {}
+
+	static int get(asio::io_context& io_context_) {return asio::use_service<basic_io_context_node>(io_context_).node;}
+	static void set(asio::io_context& io_context_, int node_) {asio::use_service<basic_io_context_node>(io_context_).node = node_;}
+
+private:
+#if ASIO_VERSION >= 101100
+	virtual void shutdown() {}
+#else
+	virtual void shutdown_service() {}
+#endif
+
+private:
+	std::atomic_int node;
+};
+template<typename Dummy> asio::io_context::id basic_io_context_node<Dummy>::id;
+
+typedef basic_io_context_node<> io_context_node;
+
+} //namespace
+
+#endif /* _ASCS_NUMA_H_ */
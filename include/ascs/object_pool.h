@@ -297,7 +297,7 @@ public:
 		return num_affected;
 	}
 
-	statistic get_statistic() {statistic stat; do_something_to_all([&](object_ctype& item) {stat += item->get_statistic();}); return stat;}
+	statistic get_statistic() {statistic stat; do_something_to_all([&](object_ctype& item) {stat += item->get_statistic_snapshot();}); return stat;}
 	void list_all_status() {do_something_to_all([](object_ctype& item) {item->show_status();});}
 	void list_all_object() {do_something_to_all([](object_ctype& item) {item->show_info("", "");});}
 
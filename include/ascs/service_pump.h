@@ -14,10 +14,55 @@
 #define _ASCS_SERVICE_PUMP_H_
 
 #include "base.h"
+#ifdef ASCS_USE_TIMING_WHEEL
+#include "timing_wheel.h"
+#endif
+#ifdef ASCS_TICK_THREAD
+#include <condition_variable>
+#endif
+#if defined(ASCS_THREAD_PLACEMENT) || (defined(ASCS_BUSY_POLL) && defined(__linux__))
+#include "numa.h"
+#endif
 
 namespace ascs
 {
 
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+//how many sockets are using an io_context, see service_pump::assign_io_context.
+template<typename Dummy = void> class basic_io_context_load : public asio::io_context::service
+{
+public:
+	//increase the load on construction and decrease it on destruction
+	class token : public asio::noncopyable
+	{
+	public:
+		token(asio::io_context& io_context_) : load(asio::use_service<basic_io_context_load>(io_context_).load) {++load;}
+		~token() {--load;}
+
+	private:
+		std::atomic_size_t& load;
+	};
+
+	static asio::io_context::id id;
+
+	basic_io_context_load(asio::io_context& io_context_) : asio::io_context::service(io_context_), load(0) {}
+	size_t size() const {return load;}
+
+private:
+#if ASIO_VERSION >= 101100
+	virtual void shutdown() {}
+#else
+	virtual void shutdown_service() {}
+#endif
+
+private:
+	std::atomic_size_t load;
+};
+template<typename Dummy> asio::io_context::id basic_io_context_load<Dummy>::id;
+
+typedef basic_io_context_load<> io_context_load;
+#endif
+
 class service_pump : public asio::io_context
 {
 public:
@@ -60,7 +105,14 @@ public:
 	typedef const object_type object_ctype;
 	typedef std::list<object_type> container_type;
 
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+	//each io_context is run by only one thread, so concurrency_hint is always 1.
 #if ASIO_VERSION >= 101200
+	service_pump(int io_context_num = ASCS_SERVICE_THREAD_NUM) : asio::io_context(1), started(false)
+#else
+	service_pump(int io_context_num = ASCS_SERVICE_THREAD_NUM) : started(false)
+#endif
+#elif ASIO_VERSION >= 101200
 	service_pump(int concurrency_hint = ASIO_CONCURRENCY_HINT_SAFE) : asio::io_context(concurrency_hint), started(false)
 #else
 	service_pump() : started(false)
@@ -68,6 +120,21 @@ public:
 #ifdef ASCS_DECREASE_THREAD_AT_RUNTIME
 		, real_thread_num(0), del_thread_num(0)
 #endif
+#ifdef ASCS_TICK_THREAD
+		, ticking(false)
+#endif
+#ifdef ASCS_BUSY_POLL
+		, busy_poll_num(ASCS_BUSY_POLL_THREAD_NUM), busy_poll_us(ASCS_BUSY_POLL_SPIN), busy_poll_cpu(ASCS_BUSY_POLL_FIRST_CPU), spinning_num(0)
+#endif
+#ifdef ASCS_AUTO_SCALE_THREAD
+		, min_thread_num(ASCS_MIN_SERVICE_THREAD_NUM), max_thread_num(ASCS_MAX_SERVICE_THREAD_NUM), busy_ns(0), lag_us(0), busy_percent(0)
+#endif
+#ifdef ASCS_THREAD_PLACEMENT
+		, next_placement(0)
+#endif
+#ifdef ASCS_ATOMIC_STATISTIC
+		, next_stat_block(0)
+#endif
 #ifdef ASCS_AVOID_AUTO_STOP_SERVICE
 #if ASIO_VERSION >= 101100
 		, work(get_executor())
@@ -75,7 +142,24 @@ public:
 		, work(std::make_shared<asio::io_service::work>(*this))
 #endif
 #endif
-	{}
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+		, next_io_context_index(0)
+#endif
+	{
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+		for (auto i = 1; i < io_context_num; ++i)
+		{
+#if ASIO_VERSION >= 101200
+			io_contexts.emplace_back(new asio::io_context(1));
+#else
+			io_contexts.emplace_back(new asio::io_context());
+#endif
+		}
+#endif
+#ifdef ASCS_MONITOR_SERVICE_THREAD
+		probes.reset(new probe_info[probe_num()]);
+#endif
+	}
 	virtual ~service_pump() {stop_service();}
 
 	object_type find(int id)
@@ -154,8 +238,12 @@ public:
 	{
 		if (!is_service_started())
 		{
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+			do_service(thread_num, true);
+#else
 			do_service(thread_num - 1);
-			run();
+#endif
+			run_service_thread(*this);
 			wait_service();
 		}
 	}
@@ -169,39 +257,227 @@ public:
 		{
 #ifdef ASCS_AVOID_AUTO_STOP_SERVICE
 			work.reset();
+#endif
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+			release_io_contexts();
+#endif
+#ifdef ASCS_TICK_THREAD
+			stop_tick();
 #endif
 			do_something_to_all([](object_type& item) {item->stop_service();});
 		}
 	}
 
+#ifdef ASCS_BUSY_POLL
+	//the first thread_num service threads will spin for spin_us microseconds before blocking, and will be pinned to CPU first_cpu + N
+	// (N is the sequence of the spinning thread, starts from zero) if first_cpu is not negative.
+	//only affect service threads started afterwards, so call it before start_service().
+	void busy_poll(int thread_num, unsigned spin_us = ASCS_BUSY_POLL_SPIN, int first_cpu = ASCS_BUSY_POLL_FIRST_CPU)
+		{busy_poll_num = std::max(thread_num, 0); busy_poll_us = spin_us; busy_poll_cpu = first_cpu;}
+	int busy_poll_thread_num() const {return busy_poll_num;}
+	unsigned busy_poll_spin() const {return busy_poll_us;}
+	int spinning_thread_num() const {return spinning_num;}
+#endif
+
+#ifdef ASCS_THREAD_PLACEMENT
+	//thread placement policies, not thread safe, call them before creating sockets (so they can allocate buffers on the right node,
+	// see io_context_node) and before start_service().
+	//service thread N (in the order of starting, or the N-th io_context with macro ASCS_IO_CONTEXT_PER_THREAD) will be pinned to
+	// cpus[N % cpus.size()].
+	void place_service_threads(const std::vector<int>& cpus)
+	{
+		placement.clear();
+		for (auto cpu : cpus)
+			placement.emplace_back(1, cpu);
+		update_io_context_node();
+	}
+	//service thread N will be bound to all CPUs of the N-th (in circle) NUMA node, so threads are spread evenly on nodes.
+	void spread_service_threads()
+	{
+		placement.clear();
+		for (auto node : numa::online_nodes())
+		{
+			auto cpus = numa::node_cpus(node);
+			if (!cpus.empty())
+				placement.emplace_back(std::move(cpus));
+		}
+		update_io_context_node();
+	}
+	//let the system decide (the default)
+	void clear_thread_placement() {placement.clear(); update_io_context_node();}
+	const std::vector<std::vector<int>>& thread_placement() const {return placement;}
+#endif
+
+#ifdef ASCS_USE_TIMING_WHEEL
+	//all timers created on this service_pump share this wheel, change its tick before any timers been started.
+	timing_wheel& get_timing_wheel() {return asio::use_service<timing_wheel>(*this);}
+#endif
+
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+	size_t io_context_num() const {return io_contexts.size() + 1;}
+	asio::io_context& get_io_context(size_t index) {return 0 == index ? *this : *io_contexts[index - 1];} //index must be less than io_context_num()
+	size_t get_io_context_load(size_t index) {return asio::use_service<io_context_load>(get_io_context(index)).size();}
+
+	//round robin
+	asio::io_context& next_io_context() {return get_io_context(next_io_context_index++ % io_context_num());}
+	//the io_context which has the least sockets
+	asio::io_context& least_loaded_io_context()
+	{
+		size_t index = 0, min_load = get_io_context_load(0);
+		for (size_t i = 1; min_load > 0 && i < io_context_num(); ++i)
+		{
+			auto load = get_io_context_load(i);
+			if (load < min_load)
+			{
+				index = i;
+				min_load = load;
+			}
+		}
+
+		return get_io_context(index);
+	}
+
+	//sockets created by servers, multi_client_base and multi_service_base call this to decide which io_context they will run on,
+	// rewrite it if you want other strategies, like next_io_context (round robin).
+	virtual asio::io_context& assign_io_context() {return least_loaded_io_context();}
+
+	bool is_running() const
+	{
+		if (!stopped())
+			return true;
+
+		for (auto& item : io_contexts)
+			if (!item->stopped())
+				return true;
+
+		return false;
+	}
+#else
+	asio::io_context& assign_io_context() {return *this;}
+
 	bool is_running() const {return !stopped();}
+#endif
 	bool is_service_started() const {return started;}
 
-	void add_service_thread(int thread_num) {for (auto i = 0; i < thread_num; ++i) service_threads.emplace_back([this]() {this->run();});}
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+	void add_service_thread(int) {unified_out::error_out("service threads are decided by io_context_num() if macro ASCS_IO_CONTEXT_PER_THREAD been defined.");}
+#else
+	void add_service_thread(int thread_num)
+	{
+		std::lock_guard<std::mutex> lock(service_threads_mutex);
+#ifdef ASCS_DECREASE_THREAD_AT_RUNTIME
+		reap_service_threads();
+#endif
+		for (auto i = 0; i < thread_num; ++i)
+			service_threads.emplace_back([this]() {this->run_service_thread(*this);});
+	}
+#endif
 #ifdef ASCS_DECREASE_THREAD_AT_RUNTIME
 	void del_service_thread(int thread_num) {if (thread_num > 0) {del_thread_num += thread_num;}}
 	int service_thread_num() const {return real_thread_num;}
 #endif
 
+#ifdef ASCS_AUTO_SCALE_THREAD
+	//service threads will be added or deleted automatically within [min_thread_num_, max_thread_num_], see macro ASCS_AUTO_SCALE_THREAD for more details.
+	//it can be called at any time, the new bounds take effect at the next scaling.
+	bool auto_scale(int min_thread_num_, int max_thread_num_)
+	{
+		if (min_thread_num_ <= 0 || max_thread_num_ < min_thread_num_)
+		{
+			unified_out::error_out("invalid auto scale bounds [%d, %d].", min_thread_num_, max_thread_num_);
+			return false;
+		}
+
+		min_thread_num = min_thread_num_;
+		max_thread_num = max_thread_num_;
+		return true;
+	}
+	int min_service_thread_num() const {return min_thread_num;}
+	int max_service_thread_num() const {return max_thread_num;}
+
+	//measured in the last scaling interval
+	unsigned reactor_lag() const {return lag_us;} //microseconds
+	unsigned busy_ratio() const {return busy_percent;} //percent
+#endif
+
+#ifdef ASCS_ATOMIC_STATISTIC
+	//sum up all service threads' counter blocks without any locks, it only includes activities happened in service threads of this service_pump
+	// (and in dispatch_pools started with it), and last_send_time, last_recv_time, establish_time, break_time, pack_time_sum and unpack_time_sum are not available.
+	statistic get_statistic() const {statistic stat; for (auto& item : stat_blocks) item.add_to(stat); return stat;}
+#ifdef ASCS_LOOP_MONITOR
+	//histograms and busy time, see macro ASCS_LOOP_MONITOR for more details.
+	loop_statistic get_loop_statistic() const {loop_statistic stat; lag_histogram.add_to(stat.lag); for (auto& item : stat_blocks) item.add_to(stat); return stat;}
+	void reset_statistic() {for (auto& item : stat_blocks) item.reset(); lag_histogram.reset();}
+#else
+	void reset_statistic() {for (auto& item : stat_blocks) item.reset();}
+#endif
+	//service threads, and other threads which work for this service_pump (see dispatch_pool::start), take their counter blocks from here.
+	thread_statistic& next_statistic_block() {return stat_blocks[next_stat_block++ % ASCS_THREAD_STATISTIC_NUM];}
+#endif
+
 protected:
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+	//one and only one thread per io_context, thread_num is ignored, if run_in_current_thread, the first io_context (this) will not get a new thread.
+	void do_service(int thread_num, bool run_in_current_thread = false)
+#else
 	void do_service(int thread_num)
+#endif
 	{
 		started = true;
 		unified_out::info_out("service pump started.");
 
 #if ASIO_VERSION >= 101100
 		restart(); //this is needed when restart service
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+		for (auto& item : io_contexts) item->restart();
+		hold_io_contexts();
+#endif
 #else
 		reset(); //this is needed when restart service
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+		for (auto& item : io_contexts) item->reset();
+		hold_io_contexts();
+#endif
 #endif
 		do_something_to_all([](object_type& item) {item->start_service();});
+#ifdef ASCS_TICK_THREAD
+		start_tick();
+#endif
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+		if (thread_num != (int) io_context_num())
+			unified_out::info_out("thread number is ignored, " ASCS_SF " service threads will be used (one per io_context).", io_context_num());
+		for (auto i = run_in_current_thread ? 1U : 0U; i < io_context_num(); ++i)
+			service_threads.emplace_back([this, i]() {this->run_service_thread(this->get_io_context(i));});
+#else
+#ifdef ASCS_THREAD_PLACEMENT
+		next_placement = 0;
+#endif
 		add_service_thread(thread_num);
+#endif
 	}
 
 	void wait_service()
 	{
-		ascs::do_something_to_all(service_threads, [](std::thread& t) {t.join();});
-		service_threads.clear();
+#ifdef ASCS_TICK_THREAD
+		stop_tick(); //end_service() is not called if services ran out by themselves (run_service())
+		if (tick_thread.joinable())
+			tick_thread.join();
+#endif
+		while (true) //threads can be added during joining (by handlers for example)
+		{
+			std::unique_lock<std::mutex> lock(service_threads_mutex);
+			if (service_threads.empty())
+				break;
+
+			auto temp_threads(std::move(service_threads));
+			service_threads.clear();
+			lock.unlock();
+
+			ascs::do_something_to_all(temp_threads, [](std::thread& t) {t.join();});
+		}
+#ifdef ASCS_DECREASE_THREAD_AT_RUNTIME
+		exited_threads.clear();
+#endif
 
 		started = false;
 #ifdef ASCS_DECREASE_THREAD_AT_RUNTIME
@@ -236,6 +512,10 @@ protected:
 		os << "service thread[" << std::this_thread::get_id() << "] begin.";
 		unified_out::info_out(os.str().data());
 		++real_thread_num;
+#ifdef ASCS_STEP_SERVICE_THREAD
+		busy_meter meter;
+		enter_service_loop(meter);
+#endif
 		while (true)
 		{
 			if (del_thread_num > 0)
@@ -243,7 +523,11 @@ protected:
 				if (--del_thread_num >= 0)
 				{
 					if (--real_thread_num > 0) //forbid to stop all service thread
+					{
+						std::lock_guard<std::mutex> lock(service_threads_mutex);
+						exited_threads.emplace_back(std::this_thread::get_id());
 						break;
+					}
 					else
 						++real_thread_num;
 				}
@@ -253,7 +537,13 @@ protected:
 
 			//we cannot always decrease service thread timely (because run_one can block).
 			size_t this_n = 0;
+#ifdef ASCS_STEP_SERVICE_THREAD
 #ifdef ASCS_ENHANCED_STABILITY
+			try {this_n = execute_one(*this, meter);} catch (const asio::system_error& e) {if (!on_exception(e)) break;}
+#else
+			this_n = execute_one(*this, meter);
+#endif
+#elif defined(ASCS_ENHANCED_STABILITY)
 			try {this_n = asio::io_context::run_one();} catch (const asio::system_error& e) {if (!on_exception(e)) break;}
 #else
 			this_n = asio::io_context::run_one();
@@ -266,6 +556,9 @@ protected:
 				break;
 			}
 		}
+#ifdef ASCS_STEP_SERVICE_THREAD
+		leave_service_loop(meter);
+#endif
 		os.str("");
 		os << "service thread[" << std::this_thread::get_id() << "] end.";
 		unified_out::info_out(os.str().data());
@@ -276,12 +569,383 @@ protected:
 #ifdef ASCS_ENHANCED_STABILITY
 	size_t run() {while (true) {try {return asio::io_context::run();} catch (const asio::system_error& e) {if (!on_exception(e)) return 0;}}}
 #endif
+#ifdef ASCS_STEP_SERVICE_THREAD
+	//execute handlers one by one to measure busy time or to spin.
+	size_t run_io_context(asio::io_context& io_context_)
+	{
+		size_t n = 0;
+		busy_meter meter;
+		enter_service_loop(meter);
+		while (true)
+		{
+			size_t this_n = 0;
+#ifdef ASCS_ENHANCED_STABILITY
+			try {this_n = execute_one(io_context_, meter);} catch (const asio::system_error& e) {if (!on_exception(e)) break; continue;}
+#else
+			this_n = execute_one(io_context_, meter);
+#endif
+			if (0 == this_n)
+				break;
+
+			n += this_n; //n can overflow, please note.
+		}
+		leave_service_loop(meter);
+
+		return n;
+	}
+#elif defined(ASCS_IO_CONTEXT_PER_THREAD)
+	size_t run_io_context(asio::io_context& io_context_)
+	{
+#ifdef ASCS_ENHANCED_STABILITY
+		while (true) {try {return io_context_.run();} catch (const asio::system_error& e) {if (!on_exception(e)) return 0;}}
+#else
+		return io_context_.run();
+#endif
+	}
+#endif
 #endif
 
 	DO_SOMETHING_TO_ALL_MUTEX(service_can, service_can_mutex)
 	DO_SOMETHING_TO_ONE_MUTEX(service_can, service_can_mutex)
 
 private:
+	void run_service_thread(asio::io_context& io_context_)
+	{
+#ifdef ASCS_ATOMIC_STATISTIC
+		thread_statistic::this_thread() = &next_statistic_block();
+#endif
+#ifdef ASCS_THREAD_PLACEMENT
+		if (!placement.empty())
+		{
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+			size_t index = 0;
+			while (index < io_context_num() && &io_context_ != &get_io_context(index))
+				++index;
+#else
+			size_t index = next_placement++;
+#endif
+			numa::pin_this_thread(placement[index % placement.size()]);
+		}
+#endif
+#if defined(ASCS_IO_CONTEXT_PER_THREAD) || (defined(ASCS_STEP_SERVICE_THREAD) && !defined(ASCS_DECREASE_THREAD_AT_RUNTIME))
+		run_io_context(io_context_);
+#else
+		(void) io_context_;
+		run();
+#endif
+#if defined(ASCS_IO_CONTEXT_PER_THREAD) && !defined(ASCS_AVOID_AUTO_STOP_SERVICE)
+		if (&io_context_ == this) //the first io_context ran out (services created on it are all stopped), let others stop after their works
+			release_io_contexts();
+#endif
+#ifdef ASCS_ATOMIC_STATISTIC
+		thread_statistic::this_thread() = nullptr;
+#endif
+	}
+
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+	//sockets can be assigned to any io_context at any time, so io_contexts except the first one must not run out before the service ends.
+	void hold_io_contexts()
+	{
+		std::lock_guard<std::mutex> lock(works_mutex);
+		works.clear();
+		for (auto& item : io_contexts)
+#if ASIO_VERSION >= 101100
+			works.emplace_back(item->get_executor());
+#else
+			works.emplace_back(std::make_shared<asio::io_service::work>(*item));
+#endif
+	}
+
+	void release_io_contexts() {std::lock_guard<std::mutex> lock(works_mutex); works.clear();}
+#endif
+
+#ifdef ASCS_DECREASE_THREAD_AT_RUNTIME
+	//join threads which have quit because of del_service_thread, service_threads_mutex must be locked.
+	void reap_service_threads()
+	{
+		for (auto& id : exited_threads)
+			for (auto iter = std::begin(service_threads); iter != std::end(service_threads); ++iter)
+				if (iter->get_id() == id)
+				{
+					iter->join();
+					service_threads.erase(iter);
+					break;
+				}
+
+		exited_threads.clear();
+	}
+#endif
+
+#ifdef ASCS_THREAD_PLACEMENT
+	void update_io_context_node()
+	{
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+		for (size_t i = 0; i < io_context_num(); ++i)
+			io_context_node::set(get_io_context(i), placement.empty() ? -1 : numa::cpus_node(placement[i % placement.size()]));
+#else
+		//all service threads share one io_context, so there's a node only if all of them are placed on it
+		std::vector<int> cpus;
+		for (auto& item : placement)
+			cpus.insert(std::end(cpus), std::begin(item), std::end(item));
+		io_context_node::set(*this, numa::cpus_node(cpus));
+#endif
+	}
+#endif
+
+#ifdef ASCS_STEP_SERVICE_THREAD
+	struct busy_meter
+	{
+		busy_meter() : time(std::chrono::steady_clock::duration::zero()), num(0)
+#ifdef ASCS_BUSY_POLL
+			, spin(std::chrono::steady_clock::duration::zero())
+#endif
+		{}
+
+		std::chrono::steady_clock::duration time;
+		unsigned num;
+#ifdef ASCS_BUSY_POLL
+		std::chrono::steady_clock::duration spin; //zero means this thread doesn't spin
+#endif
+	};
+
+	void enter_service_loop(busy_meter& meter)
+	{
+#ifdef ASCS_BUSY_POLL
+		auto index = spinning_num++;
+		if (index >= busy_poll_num)
+		{
+			--spinning_num;
+			return;
+		}
+
+		meter.spin = std::chrono::microseconds(busy_poll_us);
+		int cpu = busy_poll_cpu;
+		if (cpu >= 0)
+#ifdef __linux__
+			numa::pin_this_thread(std::vector<int>(1, cpu + index));
+#else
+			unified_out::warning_out("cannot pin service thread to CPU %d: only supported on Linux.", cpu + index);
+#endif
+#else
+		(void) meter;
+#endif
+	}
+
+	void leave_service_loop(busy_meter& meter)
+	{
+		commit_busy_time(meter);
+#ifdef ASCS_BUSY_POLL
+		if (meter.spin > std::chrono::steady_clock::duration::zero())
+			--spinning_num;
+#endif
+	}
+
+	//handlers got by poll_one are counted as busy time, run_one mostly waits (the handler which wakes it up is not counted),
+	// busy time is committed every 64 handlers or before waiting.
+	//with busy poll, spinning threads keep polling until they have been idle for meter.spin, and then wait.
+	size_t execute_one(asio::io_context& io_context_, busy_meter& meter)
+	{
+		auto begin_time = std::chrono::steady_clock::now();
+		auto n = io_context_.poll_one();
+		if (n > 0)
+		{
+			meter.time += std::chrono::steady_clock::now() - begin_time;
+			if (++meter.num < 64)
+				return n;
+		}
+
+		commit_busy_time(meter);
+		if (n > 0)
+			return n;
+#ifdef ASCS_BUSY_POLL
+		else if (meter.spin > std::chrono::steady_clock::duration::zero())
+			for (auto idle_time = begin_time; !io_context_.stopped() && begin_time - idle_time < meter.spin;)
+			{
+				begin_time = std::chrono::steady_clock::now();
+				if ((n = io_context_.poll_one()) > 0)
+				{
+					meter.time += std::chrono::steady_clock::now() - begin_time;
+					++meter.num;
+					return n;
+				}
+			}
+#endif
+
+		return io_context_.run_one();
+	}
+
+	void commit_busy_time(busy_meter& meter)
+	{
+#ifdef ASCS_MONITOR_SERVICE_THREAD
+		auto busy = (uint_fast64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(meter.time).count();
+#ifdef ASCS_AUTO_SCALE_THREAD
+		busy_ns += busy;
+#endif
+#ifdef ASCS_LOOP_MONITOR
+		thread_statistic::current().busy_time.fetch_add(busy, std::memory_order_relaxed);
+#endif
+#endif
+		meter.time = std::chrono::steady_clock::duration::zero();
+		meter.num = 0;
+	}
+#endif
+
+#ifdef ASCS_MONITOR_SERVICE_THREAD
+
+	size_t probe_num() const
+	{
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+		return io_context_num();
+#else
+		return 1;
+#endif
+	}
+
+	asio::io_context& probe_io_context(size_t index)
+	{
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+		return get_io_context(index);
+#else
+		(void) index;
+		return *this;
+#endif
+	}
+
+#endif
+
+#ifdef ASCS_TICK_THREAD
+	//monitoring runs in its own thread, otherwise it will be blocked by the backlog of an overloaded io_context, just when it's needed most,
+	// so does refreshing of the coarse clock, the same thread does both of them.
+	void start_tick()
+	{
+		ticking = true;
+#ifdef ASCS_COARSE_CLOCK
+		coarse_clock::start();
+#endif
+#ifdef ASCS_MONITOR_SERVICE_THREAD
+		for (size_t i = 0; i < probe_num(); ++i)
+			probes[i].pending = false;
+#ifdef ASCS_AUTO_SCALE_THREAD
+		busy_ns = 0;
+		scale_time = std::chrono::steady_clock::now();
+#endif
+#endif
+		tick_thread = std::thread([this]() {
+#ifdef ASCS_MONITOR_SERVICE_THREAD
+			unsigned tick_num = 0;
+#endif
+			std::unique_lock<std::mutex> lock(this->tick_mutex);
+			while (!this->tick_cv.wait_for(lock, std::chrono::milliseconds(ASCS_TICK_INTERVAL), [this]() {return !this->ticking;}))
+			{
+#ifdef ASCS_COARSE_CLOCK
+				coarse_clock::refresh();
+#endif
+#ifdef ASCS_MONITOR_SERVICE_THREAD
+				if (++tick_num >= ASCS_MONITOR_INTERVAL / ASCS_TICK_INTERVAL)
+				{
+					tick_num = 0;
+					this->monitor();
+				}
+#endif
+			}
+		});
+	}
+
+	void stop_tick()
+	{
+		std::lock_guard<std::mutex> lock(tick_mutex);
+		if (!ticking) //both end_service() and wait_service() call this
+			return;
+
+		ticking = false;
+		tick_cv.notify_one();
+#ifdef ASCS_COARSE_CLOCK
+		coarse_clock::stop();
+#endif
+	}
+#endif
+
+#ifdef ASCS_MONITOR_SERVICE_THREAD
+	void monitor()
+	{
+		auto now = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < probe_num(); ++i)
+		{
+			auto& ctx = probe_io_context(i);
+			auto& p = probes[i];
+			if (!ctx.stopped() && !p.pending) //wait for the last probe
+			{
+				p.pending = true;
+				p.time = now;
+#if ASIO_VERSION >= 101100
+				asio::post(ctx, [this, &p]() {this->on_probe(p);});
+#else
+				ctx.post([this, &p]() {this->on_probe(p);});
+#endif
+			}
+		}
+
+#ifdef ASCS_AUTO_SCALE_THREAD
+		if (!stopped() && now - scale_time >= std::chrono::milliseconds(ASCS_AUTO_SCALE_INTERVAL))
+			scale(now);
+#endif
+	}
+
+	struct probe_info
+	{
+		probe_info() : pending(false), lag_ns(0) {}
+
+		std::atomic_bool pending;
+		std::chrono::steady_clock::time_point time; //only accessed by the tick thread and the probe it posted
+		std::atomic<uint_fast64_t> lag_ns;
+	};
+
+	void on_probe(probe_info& p)
+	{
+		auto lag = (uint_fast64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - p.time).count();
+		p.lag_ns = lag;
+#ifdef ASCS_LOOP_MONITOR
+		lag_histogram.record((int_fast64_t) lag);
+#endif
+		p.pending = false;
+	}
+#endif
+
+#ifdef ASCS_AUTO_SCALE_THREAD
+	void scale(const std::chrono::steady_clock::time_point& now)
+	{
+		auto elapsed = (uint_fast64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(now - scale_time).count();
+		scale_time = now;
+
+		//if the last probe is still waiting, the lag is at least that long
+		auto& p = probes[0];
+		auto lag = p.pending ? (uint_fast64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(now - p.time).count() : p.lag_ns.load();
+		lag_us = (unsigned) (lag / 1000);
+
+		int thread_num = real_thread_num, pending_del = del_thread_num;
+		if (thread_num > 0 && elapsed > 0)
+		{
+			auto busy = busy_ns.exchange(0);
+			busy_percent = (unsigned) std::min(busy * 100 / (elapsed * thread_num), (uint_fast64_t) 100); //busy time is committed in batch
+
+			if (pending_del > 0)
+				; //the last deletion is still in progress
+			else if (thread_num < min_thread_num || (thread_num < max_thread_num &&
+				((lag_us >= ASCS_AUTO_SCALE_MAX_LAG && busy_percent >= ASCS_AUTO_SCALE_LOW_BUSY) || busy_percent >= ASCS_AUTO_SCALE_HIGH_BUSY)))
+			{
+				unified_out::info_out("auto scale: reactor lag %uus, busy ratio %u%%, add a service thread.", lag_us.load(), busy_percent.load());
+				add_service_thread(1);
+			}
+			else if (thread_num > max_thread_num || (thread_num > min_thread_num && lag_us < ASCS_AUTO_SCALE_MAX_LAG / 2 &&
+				busy * 100 / (elapsed * (thread_num - 1)) < ASCS_AUTO_SCALE_LOW_BUSY))
+			{
+				unified_out::info_out("auto scale: reactor lag %uus, busy ratio %u%%, delete a service thread.", lag_us.load(), busy_percent.load());
+				del_service_thread(1);
+			}
+		}
+	}
+#endif
+
 	void add(object_type i_service_)
 	{
 		assert(nullptr != i_service_);
@@ -299,10 +963,47 @@ private:
 	container_type service_can;
 	std::mutex service_can_mutex;
 	std::list<std::thread> service_threads;
+	std::mutex service_threads_mutex;
 
 #ifdef ASCS_DECREASE_THREAD_AT_RUNTIME
 	std::atomic_int_fast32_t real_thread_num;
 	std::atomic_int_fast32_t del_thread_num;
+	std::list<std::thread::id> exited_threads;
+#endif
+
+#ifdef ASCS_TICK_THREAD
+	std::atomic_bool ticking;
+	std::thread tick_thread;
+	std::mutex tick_mutex;
+	std::condition_variable tick_cv;
+#endif
+#ifdef ASCS_MONITOR_SERVICE_THREAD
+	std::unique_ptr<probe_info[]> probes; //one per io_context
+#endif
+#ifdef ASCS_LOOP_MONITOR
+	atomic_histogram lag_histogram;
+#endif
+#ifdef ASCS_BUSY_POLL
+	std::atomic_int busy_poll_num;
+	std::atomic_uint busy_poll_us;
+	std::atomic_int busy_poll_cpu;
+	std::atomic_int spinning_num;
+#endif
+#ifdef ASCS_AUTO_SCALE_THREAD
+	std::atomic_int min_thread_num, max_thread_num;
+	std::chrono::steady_clock::time_point scale_time;
+	std::atomic<uint_fast64_t> busy_ns;
+	std::atomic_uint lag_us, busy_percent;
+#endif
+
+#ifdef ASCS_THREAD_PLACEMENT
+	std::vector<std::vector<int>> placement; //cpus of each service thread (in circle)
+	std::atomic_uint next_placement;
+#endif
+
+#ifdef ASCS_ATOMIC_STATISTIC
+	thread_statistic stat_blocks[ASCS_THREAD_STATISTIC_NUM];
+	std::atomic_uint next_stat_block;
 #endif
 
 #ifdef ASCS_AVOID_AUTO_STOP_SERVICE
@@ -312,6 +1013,17 @@ private:
 	std::shared_ptr<asio::io_service::work> work;
 #endif
 #endif
+
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+	std::vector<std::unique_ptr<asio::io_context>> io_contexts; //except this
+	std::atomic_size_t next_io_context_index;
+#if ASIO_VERSION >= 101100
+	std::vector<asio::executor_work_guard<asio::io_context::executor_type>> works; //for io_contexts
+#else
+	std::vector<std::shared_ptr<asio::io_service::work>> works; //for io_contexts
+#endif
+	std::mutex works_mutex;
+#endif
 };
 
 } //namespace
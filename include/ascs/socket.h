@@ -16,6 +16,19 @@
 #include "tracked_executor.h"
 #include "timer.h"
 #include "container.h"
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+#include "service_pump.h"
+#endif
+#ifdef ASCS_DISPATCH_POOL
+#include "dispatch_pool.h"
+#endif
+#ifdef ASCS_THREAD_PLACEMENT
+#include "numa.h"
+#endif
+
+#if defined(ASCS_SO_BUSY_POLL) && !defined(SO_BUSY_POLL)
+#define SO_BUSY_POLL	46 //old C libraries don't define it
+#endif
 
 namespace ascs
 {
@@ -36,9 +49,17 @@ public:
 	static const tid TIMER_END = TIMER_BEGIN + 10;
 
 protected:
-	socket(asio::io_context& io_context_) : super(io_context_), next_layer_(io_context_), strand(io_context_) {first_init();}
+	socket(asio::io_context& io_context_) : super(io_context_), next_layer_(io_context_), strand(io_context_)
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+		, load_token(io_context_)
+#endif
+		{first_init();}
 	template<typename Arg>
-	socket(asio::io_context& io_context_, Arg&& arg) : super(io_context_), next_layer_(io_context_, std::forward<Arg>(arg)), strand(io_context_) {first_init();}
+	socket(asio::io_context& io_context_, Arg&& arg) : super(io_context_), next_layer_(io_context_, std::forward<Arg>(arg)), strand(io_context_)
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+		, load_token(io_context_)
+#endif
+		{first_init();}
 
 	//helper function, just call it in constructor
 	void first_init()
@@ -56,6 +77,10 @@ protected:
 		dispatching = false;
 #ifndef ASCS_DISPATCH_BATCH_MSG
 		dispatched = true;
+#endif
+#ifdef ASCS_DISPATCH_POOL
+		dispatch_pool_ = nullptr;
+		dispatch_claimed = false;
 #endif
 		recv_idle_began = false;
 		msg_resuming_interval_ = ASCS_MSG_RESUMING_INTERVAL;
@@ -73,7 +98,10 @@ protected:
 			set_async_calling(false);
 		}
 
-		stat.reset();
+		{
+			std::lock_guard<seq_lock> lock(stat_lock);
+			stat.reset();
+		}
 		packer_->reset();
 		sending = false;
 #ifdef ASCS_PASSIVE_RECV
@@ -85,6 +113,9 @@ protected:
 		dispatching = false;
 #ifndef ASCS_DISPATCH_BATCH_MSG
 		dispatched = true;
+#endif
+#ifdef ASCS_DISPATCH_POOL
+		dispatch_claimed = false;
 #endif
 		recv_idle_began = false;
 		clear_buffer();
@@ -154,7 +185,7 @@ public:
 
 		if (stat.last_recv_time > 0 && is_ready()) //check of last_recv_time is essential, because user may call check_heartbeat before do_start
 		{
-			auto now = time(nullptr);
+			auto now = coarse_clock::now();
 			if (now - stat.last_recv_time >= interval * max_absence)
 				if (!on_heartbeat_error())
 					return false;
@@ -171,6 +202,12 @@ public:
 	bool is_reading() const {return reading;}
 #endif
 	bool is_dispatching() const {return dispatching;}
+#ifdef ASCS_DISPATCH_POOL
+	//hand on_msg_handle over to the pool (nullptr means back to service threads), the pool must outlive this socket.
+	//set it before starting the socket (on_accept and constructor are good places), or in on_msg_handle.
+	void set_dispatch_pool(dispatch_pool* pool) {dispatch_pool_ = pool;}
+	dispatch_pool* get_dispatch_pool() const {return dispatch_pool_;}
+#endif
 	bool is_recv_idle() const {return recv_idle_began;}
 
 	void msg_resuming_interval(unsigned interval) {msg_resuming_interval_ = interval;}
@@ -182,9 +219,22 @@ public:
 	//in ascs, it's thread safe to access stat without mutex, because for a specific member of stat, ascs will never access it concurrently.
 	//in other words, in a specific thread, ascs just access only one member of stat.
 	//but user can access stat out of ascs via get_statistic function, although user can only read it, there's still a potential risk,
-	//so whether it's thread safe or not depends on std::chrono::system_clock::duration.
+	//so whether it's thread safe or not depends on std::chrono::steady_clock::duration.
 	//i can make it thread safe in ascs, but is it worth to do so? this is a problem.
 	const struct statistic& get_statistic() const {return stat;}
+	//with macro ASCS_ATOMIC_STATISTIC, this returns a consistent copy of stat (no torn values), otherwise, it's the same as get_statistic.
+	struct statistic get_statistic_snapshot() const
+	{
+		struct statistic snapshot;
+		unsigned seq;
+		do
+		{
+			seq = stat_lock.read_begin();
+			snapshot = stat;
+		} while (stat_lock.read_retry(seq));
+
+		return snapshot;
+	}
 
 	//get or change the packer at runtime
 	//changing packer at runtime is not thread-safe (if we're sending messages concurrently), please pay special attention,
@@ -256,11 +306,24 @@ public:
 	POP_ALL_PENDING_MSG(pop_all_pending_recv_msg, recv_msg_buffer, out_container_type)
 
 protected:
+#ifdef ASCS_SINGLE_STRAND_SOCKET
+	asio::io_context::strand& get_strand() {return strand;} //for subclasses to do receiving and sending in it
+#endif
+
 	virtual bool do_start()
 	{
-		stat.last_recv_time = time(nullptr);
+		{
+			std::lock_guard<seq_lock> lock(stat_lock);
+			stat.last_recv_time = coarse_clock::now();
+		}
 #if ASCS_HEARTBEAT_INTERVAL > 0
 		start_heartbeat(ASCS_HEARTBEAT_INTERVAL);
+#endif
+#ifdef ASCS_SO_BUSY_POLL
+		asio::error_code ec;
+		lowest_layer().set_option(asio::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL>(ASCS_SO_BUSY_POLL), ec);
+		if (ec) //needs CAP_NET_ADMIN to increase it
+			unified_out::warning_out("cannot set SO_BUSY_POLL: %s", ec.message().data());
 #endif
 		assert(is_ready());
 		send_msg(); //send buffer may have msgs, send them
@@ -276,6 +339,9 @@ protected:
 	//otherwise (bigger than zero), socket simply call this callback ASCS_DELAY_CLOSE seconds later after link down, no any guarantees.
 	virtual void on_close() {unified_out::info_out("on_close()");}
 	virtual void after_close() {} //a good case for using this is to reconnect the server, please refer to client_socket_base.
+	//called right before closing the socket (after it was shut down and all async calls finished), return false to postpone the closing,
+	// then it will be called again after ASCS_DELAY_CLOSE seconds (50 milliseconds if ASCS_DELAY_CLOSE equals to zero).
+	virtual bool is_ready_to_close() {return true;}
 
 #ifdef ASCS_SYNC_DISPATCH
 	//return the number of handled msg, if some msg left behind, socket will re-dispatch them asynchronously
@@ -338,7 +404,8 @@ protected:
 			asio::error_code ec;
 			lowest_layer().shutdown(asio::ip::tcp::socket::shutdown_both, ec);
 
-			stat.break_time = time(nullptr);
+			std::lock_guard<seq_lock> lock(stat_lock);
+			stat.break_time = coarse_clock::now();
 		}
 
 		if (stopped())
@@ -374,8 +441,13 @@ protected:
 		auto size_in_byte = ascs::get_size_in_byte(temp_msg_can);
 		auto msg_num = temp_msg_can.size();
 		auto left_msg_num = msg_num;
-		stat.recv_msg_sum += msg_num;
-		stat.recv_byte_sum += size_in_byte;
+		{
+			std::lock_guard<seq_lock> lock(stat_lock);
+			stat.recv_msg_sum += msg_num;
+			stat.recv_byte_sum += size_in_byte;
+		}
+		ASCS_THREAD_STAT_ADD(recv_msg_sum, msg_num);
+		ASCS_THREAD_STAT_ADD(recv_byte_sum, size_in_byte);
 #ifdef ASCS_SYNC_RECV
 		std::unique_lock<std::mutex> lock(sync_recv_mutex);
 		if (sync_recv_status::REQUESTED == sr_status)
@@ -397,9 +469,15 @@ protected:
 		if (left_msg_num > 0)
 #endif
 		{
-			auto_duration dur(stat.handle_time_sum);
+			auto begin_time = statistic::now();
 			on_msg(temp_msg_can);
+			auto elapsed = statistic::now() - begin_time;
 			left_msg_num = temp_msg_can.size();
+
+			std::lock_guard<seq_lock> lock(stat_lock);
+			stat.handle_time_sum += elapsed;
+			ASCS_THREAD_STAT_DURATION_ADD(handle_time_sum, elapsed);
+			ASCS_THREAD_STAT_HISTOGRAM_ADD(handle_time_histogram, elapsed);
 		}
 #elif defined(ASCS_PASSIVE_RECV)
 		if (0 == left_msg_num)
@@ -436,6 +514,32 @@ protected:
 		return true;
 	}
 
+#ifdef ASCS_APPEND_SEND_MSG
+	//pack the message into the last message in the send buffer (which has not been sent) if the packer supports it and the result
+	// will not exceed ASCS_APPEND_SEND_MSG bytes, return false if nothing appended.
+	bool do_append_msg(const char* const pstr[], const size_t len[], size_t num, bool native)
+	{
+		size_t size = native ? 0 : ASCS_HEAD_LEN; //estimated
+		for (size_t i = 0; i < num; ++i)
+			if (nullptr != pstr[i])
+				size += len[i];
+
+		auto_duration dur(stat.pack_time_sum, stat_lock);
+		auto appended = send_msg_buffer.append_to_back([&](in_msg& msg)->size_t {
+			auto old_size = msg.size();
+			return old_size + size <= ASCS_APPEND_SEND_MSG && packer_->append_msg(msg, pstr, len, num, native) ? msg.size() - old_size : 0;
+		});
+		dur.end();
+
+		if (0 == appended)
+			return false;
+		else if (!sending && is_ready())
+			send_msg();
+
+		return true;
+	}
+#endif
+
 	bool do_direct_send_msg(list<InMsgType>& msg_can)
 	{
 		size_t size_in_byte = 0;
@@ -521,7 +625,12 @@ private:
 			if (recv_idle_began)
 			{
 				recv_idle_began = false;
-				stat.recv_idle_sum += statistic::now() - recv_idle_begin_time;
+				auto elapsed = statistic::now() - recv_idle_begin_time;
+				{
+					std::lock_guard<seq_lock> lock(stat_lock);
+					stat.recv_idle_sum += elapsed;
+				}
+				ASCS_THREAD_STAT_DURATION_ADD(recv_idle_sum, elapsed);
 			}
 
 			if (raise_recv)
@@ -549,20 +658,83 @@ private:
 		return false;
 	}
 
+	void update_dispatch_stat(const typename statistic::stat_duration& dispatch_delay, const typename statistic::stat_duration& handle_time)
+	{
+		{
+			std::lock_guard<seq_lock> lock(stat_lock);
+			stat.dispatch_delay_sum += dispatch_delay;
+			stat.handle_time_sum += handle_time;
+		}
+		ASCS_THREAD_STAT_DURATION_ADD(dispatch_delay_sum, dispatch_delay);
+		ASCS_THREAD_STAT_DURATION_ADD(handle_time_sum, handle_time);
+		ASCS_THREAD_STAT_HISTOGRAM_ADD(handle_time_histogram, handle_time);
+	}
+
 	//do not use dispatch_strand at here, because the handler (do_dispatch_msg) may call this function, which can lead stack overflow.
-	void dispatch_msg() {if (!dispatching) post_strand(strand, [this]() {this->do_dispatch_msg();});}
+#ifdef ASCS_DISPATCH_POOL
+	void dispatch_msg()
+	{
+		if (nullptr == dispatch_pool_)
+		{
+			if (!dispatching)
+				post_dispatch_msg();
+		}
+		//dispatch_claimed is held until do_dispatch_msg returned, so at most one dispatching task of this socket exists in the pool.
+		else if (!dispatching && !dispatch_claimed.exchange(true))
+		{
+			auto posted = dispatch_pool_->post(make_handler([this]() {
+				this->do_dispatch_msg(); //the dispatch_msg it invokes will do nothing, we re-check after releasing dispatch_claimed
+				this->dispatch_claimed = false;
+				if (!this->dispatching && !this->recv_msg_buffer.empty())
+					this->dispatch_msg();
+			}));
+			if (!posted) //the pool is not started or is stopping, dispatch in service threads
+			{
+				dispatch_claimed = false;
+				if (!dispatching)
+					post_dispatch_msg();
+			}
+		}
+	}
+#else
+	void dispatch_msg() {if (!dispatching) post_dispatch_msg();}
+#endif
+#ifdef ASCS_HANDLER_MEMORY
+	void post_dispatch_msg()
+	{
+		auto handler = make_allocated_handler(dispatch_memory, make_handler([this]() {this->do_dispatch_msg();}));
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+#if ASIO_VERSION >= 101100
+		asio::post(lowest_layer().get_executor(), std::move(handler));
+#else
+		lowest_layer().get_io_service().post(std::move(handler));
+#endif
+#elif ASIO_VERSION >= 101100
+		asio::post(strand, std::move(handler));
+#else
+		strand.post(std::move(handler));
+#endif
+	}
+#else
+	void post_dispatch_msg() {post_strand(strand, [this]() {this->do_dispatch_msg();});}
+#endif
 	void do_dispatch_msg()
 	{
 #ifdef ASCS_DISPATCH_BATCH_MSG
 		if ((dispatching = !recv_msg_buffer.empty()))
 		{
 			auto begin_time = statistic::now();
+			typename statistic::stat_duration dispatch_delay;
 #ifdef ASCS_FULL_STATISTIC
-			recv_msg_buffer.do_something_to_all([&, this](out_msg& msg) {this->stat.dispatch_delay_sum += begin_time - msg.begin_time;});
+			dispatch_delay = statistic::stat_duration(0);
+			recv_msg_buffer.do_something_to_all([&](out_msg& msg) {
+				dispatch_delay += begin_time - msg.begin_time;
+				ASCS_THREAD_STAT_HISTOGRAM_ADD(dispatch_delay_histogram, begin_time - msg.begin_time);
+			});
 #endif
 			auto re = on_msg_handle(recv_msg_buffer);
 			auto end_time = statistic::now();
-			stat.handle_time_sum += end_time - begin_time;
+			update_dispatch_stat(dispatch_delay, end_time - begin_time);
 
 			if (0 == re) //dispatch failed, re-dispatch
 			{
@@ -577,10 +749,11 @@ private:
 		if ((dispatching = !dispatched || recv_msg_buffer.try_dequeue(last_dispatch_msg)))
 		{
 			auto begin_time = statistic::now();
-			stat.dispatch_delay_sum += begin_time - last_dispatch_msg.begin_time;
+			auto dispatch_delay = begin_time - last_dispatch_msg.begin_time;
+			ASCS_THREAD_STAT_HISTOGRAM_ADD(dispatch_delay_histogram, dispatch_delay);
 			auto re = on_msg_handle(last_dispatch_msg); //must before next msg dispatching to keep sequence
 			auto end_time = statistic::now();
-			stat.handle_time_sum += end_time - begin_time;
+			update_dispatch_stat(dispatch_delay, end_time - begin_time);
 
 			if (!re) //dispatch failed, re-dispatch
 			{
@@ -609,7 +782,7 @@ private:
 			dispatch_msg();
 			break;
 		case TIMER_DELAY_CLOSE:
-			if (!is_last_async_call())
+			if (!is_last_async_call() || !is_ready_to_close())
 			{
 				stop_all_timer(TIMER_DELAY_CLOSE);
 				return true;
@@ -634,6 +807,7 @@ private:
 
 protected:
 	struct statistic stat;
+	mutable seq_lock stat_lock; //see macro ASCS_ATOMIC_STATISTIC
 	std::shared_ptr<i_packer<typename Packer::msg_type>> packer_;
 	list<OutMsgType> temp_msg_can;
 
@@ -647,7 +821,11 @@ protected:
 private:
 	bool recv_idle_began;
 	volatile bool started_; //has started or not
+#ifdef ASCS_DISPATCH_POOL
+	std::atomic_bool dispatching; //written by pool workers and read by service threads (dispatch_msg)
+#else
 	volatile bool dispatching;
+#endif
 #ifndef ASCS_DISPATCH_BATCH_MSG
 	bool dispatched;
 	out_msg last_dispatch_msg;
@@ -661,6 +839,13 @@ private:
 
 	std::atomic_flag start_atomic;
 	asio::io_context::strand strand;
+#ifdef ASCS_HANDLER_MEMORY
+	handler_memory<ASCS_SMALL_HANDLER_MEMORY_SIZE> dispatch_memory; //dispatching can overlap (posted by different threads), overlapped ones use the heap
+#endif
+#ifdef ASCS_DISPATCH_POOL
+	dispatch_pool* dispatch_pool_;
+	std::atomic_bool dispatch_claimed;
+#endif
 
 #ifdef ASCS_SYNC_RECV
 	enum sync_recv_status {NOT_REQUESTED, REQUESTED, RESPONDED, RESPONDED_FAILURE};
@@ -671,6 +856,9 @@ private:
 #endif
 
 	unsigned msg_resuming_interval_, msg_handling_interval_;
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+	io_context_load::token load_token;
+#endif
 };
 
 } //namespace
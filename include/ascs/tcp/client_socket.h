@@ -15,6 +15,10 @@
 
 #include "socket.h"
 
+#if defined(ASCS_TCP_FASTOPEN_CONNECT) && !defined(TCP_FASTOPEN_CONNECT)
+#define TCP_FASTOPEN_CONNECT	30 //old C libraries don't define it
+#endif
+
 namespace ascs { namespace tcp {
 
 template <typename Packer, typename Unpacker, typename Matrix = i_matrix, typename Socket = asio::ip::tcp::socket,
@@ -33,8 +37,8 @@ public:
 	client_socket_base(asio::io_context& io_context_) : super(io_context_) {first_init();}
 	template<typename Arg> client_socket_base(asio::io_context& io_context_, Arg&& arg) : super(io_context_, std::forward<Arg>(arg)) {first_init();}
 
-	client_socket_base(Matrix& matrix_) : super(matrix_.get_service_pump()) {first_init(&matrix_);}
-	template<typename Arg> client_socket_base(Matrix& matrix_, Arg&& arg) : super(matrix_.get_service_pump(), std::forward<Arg>(arg)) {first_init(&matrix_);}
+	client_socket_base(Matrix& matrix_) : super(matrix_.get_service_pump().assign_io_context()) {first_init(&matrix_);}
+	template<typename Arg> client_socket_base(Matrix& matrix_, Arg&& arg) : super(matrix_.get_service_pump().assign_io_context(), std::forward<Arg>(arg)) {first_init(&matrix_);}
 
 	virtual const char* type_name() const {return "TCP (client endpoint)";}
 	virtual int type_id() const {return 1;}
@@ -119,6 +123,25 @@ protected:
 			}
 		}
 
+#ifdef ASCS_TCP_FASTOPEN_CONNECT
+		asio::error_code ec;
+		if (!lowest_object.is_open())
+		{
+			lowest_object.open(server_addr.protocol(), ec); assert(!ec);
+			if (ec)
+			{
+				unified_out::error_out("cannot create socket: %s", ec.message().data());
+				return false;
+			}
+		}
+
+		//connecting will succeed immediately, and the first sending will carry data on the SYN,
+		//if failed (for example, the kernel doesn't support it), just connect normally.
+		lowest_object.set_option(asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_FASTOPEN_CONNECT>(true), ec);
+		if (ec)
+			unified_out::warning_out("cannot set TCP_FASTOPEN_CONNECT: %s", ec.message().data());
+#endif
+
 		lowest_object.async_connect(server_addr, this->make_handler_error([this](const asio::error_code& ec) {this->connect_handler(ec);}));
 		return true;
 	}
@@ -15,6 +15,17 @@
 
 #include "../object_pool.h"
 
+#if defined(ASCS_REUSE_PORT_ACCEPTOR_NUM) && !defined(SO_REUSEPORT)
+	#error SO_REUSEPORT is not supported on this platform, please undefine ASCS_REUSE_PORT_ACCEPTOR_NUM.
+#endif
+
+//acceptors are managed as shards if we have more than one acceptor or accept connections in batch
+#ifdef ASCS_REUSE_PORT_ACCEPTOR_NUM
+	#define ASCS_ACCEPTOR_SHARD_NUM ASCS_REUSE_PORT_ACCEPTOR_NUM
+#elif defined(ASCS_ACCEPT_BATCH_NUM)
+	#define ASCS_ACCEPTOR_SHARD_NUM 1
+#endif
+
 namespace ascs { namespace tcp {
 
 template<typename Socket, typename Pool = object_pool<Socket>, typename Server = i_server>
@@ -49,14 +60,34 @@ public:
 
 	bool start_listen()
 	{
-		asio::error_code ec;
-		if (!acceptor.is_open()) {acceptor.open(server_addr.protocol(), ec); assert(!ec);} //user maybe has opened this acceptor (to set options for example)
-#ifndef ASCS_NOT_REUSE_ADDRESS
-		acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true), ec); assert(!ec);
+#ifdef ASCS_ACCEPTOR_SHARD_NUM
+		if (shards.empty())
+		{
+			shards.emplace_back(acceptor);
+			for (auto i = 1; i < ASCS_ACCEPTOR_SHARD_NUM; ++i)
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+				shards.emplace_back(get_service_pump().get_io_context(i % get_service_pump().io_context_num()));
+#else
+				shards.emplace_back(get_service_pump());
 #endif
-		acceptor.bind(server_addr, ec); assert(!ec);
-		if (ec) {unified_out::error_out("bind failed."); return false;}
+		}
 
+		for (auto& item : shards)
+			if (!bind_acceptor(item.acceptor))
+				return false;
+#else
+		if (!bind_acceptor(acceptor))
+			return false;
+#endif
+
+#ifdef ASCS_ACCEPT_BATCH_NUM
+		for (auto& item : shards)
+			if (!listen_acceptor(item.acceptor))
+				return false;
+
+		for (auto& item : shards) //server sockets will be created on demand
+			do_async_wait(item);
+#else
 		auto num = async_accept_num();
 		assert(num > 0);
 		if (num <= 0)
@@ -77,18 +108,25 @@ public:
 		else
 			unified_out::info_out("finished pre-creating server sockets.");
 
-#if ASIO_VERSION >= 101100
-		acceptor.listen(asio::ip::tcp::acceptor::max_listen_connections, ec); assert(!ec);
+#ifdef ASCS_ACCEPTOR_SHARD_NUM
+		for (auto& item : shards)
+			if (!listen_acceptor(item.acceptor))
+				return false;
 #else
-		acceptor.listen(asio::ip::tcp::acceptor::max_connections, ec); assert(!ec);
+		if (!listen_acceptor(acceptor))
+			return false;
 #endif
-		if (ec) {unified_out::error_out("listen failed."); return false;}
 
 		ascs::do_something_to_all(sockets, [this](typename Pool::object_ctype& item) {this->do_async_accept(item);});
+#endif
 		return true;
 	}
 	bool is_listening() const {return acceptor.is_open();}
+#ifdef ASCS_ACCEPTOR_SHARD_NUM
+	void stop_listen() {asio::error_code ec; for (auto& item : shards) {item.acceptor.cancel(ec); item.acceptor.close(ec);}}
+#else
 	void stop_listen() {asio::error_code ec; acceptor.cancel(ec); acceptor.close(ec);}
+#endif
 
 	asio::ip::tcp::acceptor& next_layer() {return acceptor;}
 	const asio::ip::tcp::acceptor& next_layer() const {return acceptor;}
@@ -157,7 +195,13 @@ protected:
 	virtual void uninit() {this->stop(); stop_listen(); force_shutdown();} //if you wanna graceful shutdown, call graceful_shutdown before service_pump::stop_service invocation.
 
 	virtual bool on_accept(typename Pool::object_ctype& socket_ptr) {return true;}
+#ifdef ASCS_ACCEPT_BATCH_NUM
+	//in batch mode, accepting will not stop after each connection, so this will not be called by server_base, but you can still call it to resume
+	// accepting after on_accept_error returned false.
+	virtual void start_next_accept() {for (auto& item : shards) do_async_wait(item);}
+#else
 	virtual void start_next_accept() {do_async_accept(create_object());}
+#endif
 
 	//if you want to ignore this error and continue to accept new connections immediately, return true in this virtual function;
 	//if you want to ignore this error and continue to accept new connections after a specific delay, start a timer immediately and return false (don't call stop_listen()),
@@ -195,6 +239,49 @@ protected:
 	}
 
 private:
+	bool bind_acceptor(asio::ip::tcp::acceptor& acceptor_)
+	{
+		asio::error_code ec;
+		if (!acceptor_.is_open()) {acceptor_.open(server_addr.protocol(), ec); assert(!ec);} //user maybe has opened this acceptor (to set options for example)
+#ifndef ASCS_NOT_REUSE_ADDRESS
+		acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true), ec); assert(!ec);
+#endif
+#ifdef ASCS_REUSE_PORT_ACCEPTOR_NUM
+		acceptor_.set_option(reuse_port(true), ec); assert(!ec);
+#endif
+		acceptor_.bind(server_addr, ec); assert(!ec);
+		if (ec) {unified_out::error_out("bind failed."); return false;}
+
+		//failing to set the following options is not fatal
+#ifdef ASCS_TCP_DEFER_ACCEPT
+		acceptor_.set_option(asio::detail::socket_option::integer<IPPROTO_TCP, TCP_DEFER_ACCEPT>(ASCS_TCP_DEFER_ACCEPT), ec);
+		if (ec) unified_out::warning_out("cannot set TCP_DEFER_ACCEPT: %s", ec.message().data());
+#endif
+#ifdef ASCS_TCP_FASTOPEN
+		acceptor_.set_option(asio::detail::socket_option::integer<IPPROTO_TCP, TCP_FASTOPEN>(ASCS_TCP_FASTOPEN), ec);
+		if (ec) unified_out::warning_out("cannot set TCP_FASTOPEN: %s", ec.message().data());
+#endif
+
+		return true;
+	}
+
+	bool listen_acceptor(asio::ip::tcp::acceptor& acceptor_)
+	{
+		asio::error_code ec;
+#if ASIO_VERSION >= 101100
+		acceptor_.listen(asio::ip::tcp::acceptor::max_listen_connections, ec); assert(!ec);
+#else
+		acceptor_.listen(asio::ip::tcp::acceptor::max_connections, ec); assert(!ec);
+#endif
+		if (ec) {unified_out::error_out("listen failed."); return false;}
+#ifdef ASCS_ACCEPT_BATCH_NUM
+		acceptor_.non_blocking(true, ec); assert(!ec);
+		if (ec) {unified_out::error_out("cannot set acceptor to non-blocking mode."); return false;}
+#endif
+
+		return true;
+	}
+
 	void accept_handler(const asio::error_code& ec, typename Pool::object_ctype& socket_ptr)
 	{
 		if (!ec)
@@ -209,12 +296,90 @@ private:
 			start_next_accept();
 	}
 
+#ifdef ASCS_ACCEPT_BATCH_NUM
+	struct acceptor_shard;
+	void do_async_wait(acceptor_shard& shard)
+	{
+		if (shard.pending.exchange(1) > 0) //already waiting or accepting
+			return;
+
+		shard.acceptor.async_wait(asio::ip::tcp::acceptor::wait_read, [this, &shard](const asio::error_code& ec) {
+			auto go_on = ec ? this->on_accept_error(ec, shard.spare_socket) : this->batch_accept(shard);
+			shard.pending = 0;
+			if (go_on && this->is_listening())
+				this->do_async_wait(shard);
+		});
+	}
+
+	//drain the listen queue with non-blocking accept until it's empty or ASCS_ACCEPT_BATCH_NUM connections been accepted,
+	// return false to stop accepting.
+	bool batch_accept(acceptor_shard& shard)
+	{
+		for (auto i = 0; i < ASCS_ACCEPT_BATCH_NUM; ++i)
+		{
+			if (!shard.spare_socket)
+			{
+				shard.spare_socket = create_object();
+				if (!shard.spare_socket)
+					return false;
+			}
+
+			asio::error_code ec;
+			shard.acceptor.accept(shard.spare_socket->lowest_layer(), ec);
+			if (asio::error::would_block == ec || asio::error::try_again == ec) //listen queue is empty, keep the spare socket for next batch
+				break;
+			else if (ec)
+				return on_accept_error(ec, shard.spare_socket);
+
+			auto socket_ptr(std::move(shard.spare_socket));
+			if (on_accept(socket_ptr))
+				add_socket(socket_ptr);
+		}
+
+		return true;
+	}
+#elif defined(ASCS_REUSE_PORT_ACCEPTOR_NUM)
+	void do_async_accept(typename Pool::object_ctype& socket_ptr)
+	{
+		if (!socket_ptr || shards.empty())
+			return;
+
+		auto shard = &shards.front(); //the one which has the fewest pending accepts
+		for (auto& item : shards)
+			if (item.pending < shard->pending)
+				shard = &item;
+
+		++shard->pending;
+		shard->acceptor.async_accept(socket_ptr->lowest_layer(), [=](const asio::error_code& ec) {--shard->pending; this->accept_handler(ec, socket_ptr);});
+	}
+#else
 	void do_async_accept(typename Pool::object_ctype& socket_ptr)
 		{if (socket_ptr) acceptor.async_accept(socket_ptr->lowest_layer(), [=](const asio::error_code& ec) {this->accept_handler(ec, socket_ptr);});}
+#endif
 
 private:
 	asio::ip::tcp::endpoint server_addr;
 	asio::ip::tcp::acceptor acceptor;
+
+#ifdef ASCS_REUSE_PORT_ACCEPTOR_NUM
+	typedef asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+#endif
+
+#ifdef ASCS_ACCEPTOR_SHARD_NUM
+	struct acceptor_shard
+	{
+		acceptor_shard(asio::ip::tcp::acceptor& acceptor_) : acceptor(acceptor_), pending(0) {}
+		acceptor_shard(asio::io_context& io_context_) : holder(new asio::ip::tcp::acceptor(io_context_)), acceptor(*holder), pending(0) {}
+
+		std::unique_ptr<asio::ip::tcp::acceptor> holder;
+		asio::ip::tcp::acceptor& acceptor;
+		std::atomic_int pending; //pending async accepts (async wait in batch mode)
+#ifdef ASCS_ACCEPT_BATCH_NUM
+		typename Pool::object_type spare_socket; //created but not used by the last batch
+#endif
+	};
+	std::list<acceptor_shard> shards; //the first one is acceptor, created at the first start_listen and never be destroyed before this server
+#endif
 };
 
 }} //namespace
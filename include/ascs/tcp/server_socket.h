@@ -27,8 +27,8 @@ private:
 	typedef socket_base<Socket, Packer, Unpacker, InQueue, InContainer, OutQueue, OutContainer> super;
 
 public:
-	server_socket_base(Server& server_) : super(server_.get_service_pump()), server(server_) {}
-	template<typename Arg> server_socket_base(Server& server_, Arg&& arg) : super(server_.get_service_pump(), std::forward<Arg>(arg)), server(server_) {}
+	server_socket_base(Server& server_) : super(server_.get_service_pump().assign_io_context()), server(server_) {}
+	template<typename Arg> server_socket_base(Server& server_, Arg&& arg) : super(server_.get_service_pump().assign_io_context(), std::forward<Arg>(arg)), server(server_) {}
 
 	virtual const char* type_name() const {return "TCP (server endpoint)";}
 	virtual int type_id() const {return 2;}
@@ -15,6 +15,27 @@
 
 #include "../socket.h"
 
+#ifdef ASCS_ZEROCOPY_SEND
+#if ASIO_VERSION < 101100
+	#error ASCS_ZEROCOPY_SEND needs asio 1.11 or newer (to wait for the error queue).
+#endif
+#include <deque>
+#include <linux/errqueue.h>
+
+#ifndef SO_ZEROCOPY //old C libraries don't define them
+#define SO_ZEROCOPY	60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY	0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY	5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED	1
+#endif
+#endif
+
 namespace ascs { namespace tcp {
 
 template <typename Socket, typename Packer, typename Unpacker,
@@ -33,11 +54,35 @@ private:
 protected:
 	enum link_status {CONNECTED, FORCE_SHUTTING_DOWN, GRACEFUL_SHUTTING_DOWN, BROKEN};
 
-	socket_base(asio::io_context& io_context_) : super(io_context_), strand(io_context_) {first_init();}
-	template<typename Arg> socket_base(asio::io_context& io_context_, Arg&& arg) : super(io_context_, std::forward<Arg>(arg)), strand(io_context_) {first_init();}
+#ifdef ASCS_SINGLE_STRAND_SOCKET
+	socket_base(asio::io_context& io_context_) : super(io_context_), strand(super::get_strand()) {first_init(io_context_);}
+	template<typename Arg> socket_base(asio::io_context& io_context_, Arg&& arg) : super(io_context_, std::forward<Arg>(arg)), strand(super::get_strand()) {first_init(io_context_);}
+#else
+	socket_base(asio::io_context& io_context_) : super(io_context_), strand(io_context_) {first_init(io_context_);}
+	template<typename Arg> socket_base(asio::io_context& io_context_, Arg&& arg) : super(io_context_, std::forward<Arg>(arg)), strand(io_context_) {first_init(io_context_);}
+#endif
 
 	//helper function, just call it in constructor
-	void first_init() {status = link_status::BROKEN; unpacker_ = std::make_shared<Unpacker>();}
+	void first_init(asio::io_context& io_context_)
+	{
+		status = link_status::BROKEN;
+#ifdef ASCS_THREAD_PLACEMENT
+		unpacker_ = std::allocate_shared<Unpacker>(numa_allocator<Unpacker>(io_context_node::get(io_context_)));
+#else
+		(void) io_context_;
+		unpacker_ = std::make_shared<Unpacker>();
+#endif
+#ifdef ASCS_SEND_COALESCING
+		coalesce_delay = 0;
+		coalesce_size = 0;
+		hold_seq = 0;
+		cork = corked = holding = flushing = false;
+#endif
+#ifdef ASCS_ZEROCOPY_SEND
+		zerocopy = zerocopy_sending = zerocopy_waiting = zerocopy_closing = false;
+		zerocopy_done_id = zerocopy_calls = 0;
+#endif
+	}
 
 public:
 	static const typename super::tid TIMER_BEGIN = super::TIMER_END;
@@ -48,7 +93,7 @@ public:
 	virtual bool is_ready() {return is_connected();}
 	virtual void send_heartbeat()
 	{
-		auto_duration dur(stat.pack_time_sum);
+		auto_duration dur(stat.pack_time_sum, stat_lock);
 		auto msg = packer_->pack_heartbeat();
 		dur.end();
 		do_direct_send_msg(std::move(msg));
@@ -59,7 +104,21 @@ public:
 	//notice, when reusing this socket, object_pool will invoke this function, so if you want to do some additional initialization
 	// for this socket, do it at here and in the constructor.
 	//for tcp::single_client_base and ssl::single_client_base, this virtual function will never be called, please note.
-	virtual void reset() {status = link_status::BROKEN; last_send_msg.clear(); unpacker_->reset(); super::reset();}
+	virtual void reset()
+	{
+		status = link_status::BROKEN;
+		last_send_msg.clear();
+		unpacker_->reset();
+#ifdef ASCS_SEND_COALESCING
+		corked = holding = flushing = false;
+#endif
+#ifdef ASCS_ZEROCOPY_SEND
+		abort_zerocopy_msgs(); //only if the socket was not closed via is_ready_to_close (service_pump stopped)
+		zerocopy_done.clear();
+		zerocopy_sending = zerocopy_waiting = zerocopy_closing = false;
+#endif
+		super::reset();
+	}
 
 	//SOCKET status
 	bool is_broken() const {return link_status::BROKEN == status;}
@@ -113,6 +172,17 @@ public:
 			this->is_dispatching(), status, this->is_recv_idle());
 	}
 
+#ifdef ASCS_SEND_COALESCING
+	//before each sending, hold it for at most delay microseconds or until max_size bytes are waiting (whichever comes first),
+	// so small messages will be sent in bigger batches (less writev and tcp segments), 0 delay disables it (the default).
+	//if cork_ is true, TCP_CORK will be set when holding begins, and be cleared after all messages been sent (Linux only, ignored on other platforms).
+	//not thread safe, call it before starting this socket or in the strand (on_connect for example).
+	void coalesce_sending(unsigned delay, size_t max_size = asio::detail::default_max_transfer_size, bool cork_ = false)
+		{coalesce_delay = delay; coalesce_size = max_size; cork = cork_;}
+	unsigned coalesce_sending_delay() const {return coalesce_delay;}
+	size_t coalesce_sending_size() const {return coalesce_size;}
+#endif
+
 	//get or change the unpacker at runtime
 	std::shared_ptr<i_unpacker<out_msg_type>> unpacker() {return unpacker_;}
 	std::shared_ptr<const i_unpacker<out_msg_type>> unpacker() const {return unpacker_;}
@@ -133,6 +203,24 @@ public:
 	TCP_SAFE_SEND_MSG(safe_send_msg, send_msg)
 	TCP_SAFE_SEND_MSG(safe_send_native_msg, send_native_msg)
 
+	//build the msg in place to avoid the packer's memory replication: get a msg with room for the header from prepare_msg, append (serialize)
+	// the body to it, then send it via (sync_)(safe_)send_prepared_msg, which fills the header in place and puts the msg into the send buffer.
+	//the packer must support it (see i_packer::prepare_msg and i_packer::finalize_msg).
+	in_msg_type prepare_msg(size_t body_len = 0) {return packer_->prepare_msg(body_len);}
+	bool send_prepared_msg(in_msg_type&& msg, bool can_overflow = false)
+	{
+		if (!can_overflow && !this->is_send_buffer_available())
+			return false;
+
+		auto_duration dur(stat.pack_time_sum, stat_lock);
+		if (!packer_->finalize_msg(msg))
+			msg.clear(); //treat it as a packing failure, see do_direct_send_msg for more details
+		dur.end();
+		return do_direct_send_msg(std::move(msg));
+	}
+	bool safe_send_prepared_msg(in_msg_type&& msg, bool can_overflow = false)
+		{while (!send_prepared_msg(std::move(msg), can_overflow)) SAFE_SEND_MSG_CHECK(false) return true;}
+
 #ifdef ASCS_SYNC_SEND
 	TCP_SYNC_SEND_MSG(sync_send_msg, false) //use the packer with native = false to pack the msgs
 	TCP_SYNC_SEND_MSG(sync_send_native_msg, true) //use the packer with native = true to pack the msgs
@@ -140,6 +228,21 @@ public:
 	//success at here just means put the msg into tcp::socket_base's send buffer
 	TCP_SYNC_SAFE_SEND_MSG(sync_safe_send_msg, sync_send_msg)
 	TCP_SYNC_SAFE_SEND_MSG(sync_safe_send_native_msg, sync_send_native_msg)
+
+	sync_call_result sync_send_prepared_msg(in_msg_type&& msg, unsigned duration = 0, bool can_overflow = false)
+	{
+		if (!can_overflow && !this->is_send_buffer_available())
+			return sync_call_result::NOT_APPLICABLE;
+
+		auto_duration dur(stat.pack_time_sum, stat_lock);
+		if (!packer_->finalize_msg(msg))
+			msg.clear();
+		dur.end();
+		return do_direct_sync_send_msg(std::move(msg), duration);
+	}
+	sync_call_result sync_safe_send_prepared_msg(in_msg_type&& msg, unsigned duration = 0, bool can_overflow = false)
+		{while (sync_call_result::SUCCESS != sync_send_prepared_msg(std::move(msg), duration, can_overflow))
+			SAFE_SEND_MSG_CHECK(sync_call_result::NOT_APPLICABLE) return sync_call_result::SUCCESS;}
 #endif
 	//msg sending interface
 	///////////////////////////////////////////////////
@@ -177,9 +280,36 @@ protected:
 	virtual bool do_start()
 	{
 		status = link_status::CONNECTED;
-		stat.establish_time = time(nullptr);
+		{
+			std::lock_guard<seq_lock> lock(stat_lock);
+			stat.establish_time = coarse_clock::now();
+		}
 
 		on_connect(); //in this virtual function, stat.last_recv_time has not been updated (super::do_start will update it), please note
+#if defined(ASCS_SPECULATIVE_SEND) || defined(ASCS_SPECULATIVE_RECV)
+		if (std::is_base_of<typename Socket::lowest_layer_type, Socket>::value) //ssl streams cannot be written or read speculatively
+		{
+			asio::error_code ec;
+			this->lowest_layer().non_blocking(true, ec); //if failed, speculative sending and receiving will be disabled on this socket
+		}
+#endif
+#ifdef ASCS_SPECULATIVE_RECV
+		recv_budget = ASCS_SPECULATIVE_RECV;
+#endif
+#ifdef ASCS_ZEROCOPY_SEND
+		zerocopy = false;
+		zerocopy_done_id = 0; //the kernel numbers MSG_ZEROCOPY sendings per socket
+		zerocopy_waiting = false;
+		zerocopy_done.clear(); //from the previous connection
+		zerocopy_msgs.clear(); //always empty, the previous connection released or aborted them before closing (see is_ready_to_close)
+		zerocopy_closing = false;
+		if (std::is_base_of<typename Socket::lowest_layer_type, Socket>::value) //ssl streams send their own (encrypted) buffers
+		{
+			asio::error_code ec;
+			this->lowest_layer().set_option(asio::detail::socket_option::boolean<SOL_SOCKET, SO_ZEROCOPY>(true), ec);
+			zerocopy = !ec; //old kernels
+		}
+#endif
 		return super::do_start();
 	}
 
@@ -190,6 +320,12 @@ protected:
 	virtual void on_send_error(const asio::error_code& ec, typename super::in_container_type& msg_can)
 		{unified_out::error_out("send msg error (%d %s)", ec.value(), ec.message().data());}
 
+#ifdef ASCS_WANT_BATCH_MSG_SEND_NOTIFY
+	//all messages in msg_can (in sending order) have been sent to the kernel buffer by one write, notice: they are packed.
+	//DO NOT hold msg_can for future using, just swap or splice its content into your own container if you want to reuse them.
+	virtual void on_msgs_send(typename super::in_container_type& msg_can) {}
+#endif
+
 	virtual void on_recv_error(const asio::error_code& ec) = 0;
 
 	virtual void on_close()
@@ -202,6 +338,32 @@ protected:
 	}
 
 	virtual void on_connect() {}
+#ifdef ASCS_ZEROCOPY_SEND
+	//the kernel keeps transmitting (and so reading) messages sent with MSG_ZEROCOPY after the socket was shut down, wait for their completions
+	// (which still arrive in the error queue until the socket is closed) for at most ASCS_GRACEFUL_SHUTDOWN_MAX_DURATION seconds, then abort
+	// the connection to let the kernel drop them, freeing them before either of these is not safe.
+	virtual bool is_ready_to_close()
+	{
+		if (!zerocopy_msgs.empty())
+		{
+			auto now = std::chrono::steady_clock::now();
+			if (!zerocopy_closing)
+			{
+				zerocopy_closing = true;
+				zerocopy_close_time = now;
+			}
+
+			release_zerocopy_msgs(); //will not wait any more, the socket has been closed
+			if (!zerocopy_msgs.empty() && now - zerocopy_close_time < std::chrono::seconds(ASCS_GRACEFUL_SHUTDOWN_MAX_DURATION))
+				return false;
+
+			abort_zerocopy_msgs();
+		}
+
+		zerocopy_closing = false;
+		return super::is_ready_to_close();
+	}
+#endif
 	//msg can not be unpacked
 	//the socket is still available, so don't need to shutdown this tcp::socket_base
 	virtual void on_unpack_error() = 0;
@@ -217,6 +379,9 @@ private:
 	using super::handle_error;
 	using super::handle_msg;
 	using super::do_direct_send_msg;
+#ifdef ASCS_APPEND_SEND_MSG
+	using super::do_append_msg;
+#endif
 #ifdef ASCS_SYNC_SEND
 	using super::do_direct_sync_send_msg;
 #endif
@@ -230,7 +395,7 @@ private:
 
 	size_t completion_checker(const asio::error_code& ec, size_t bytes_transferred)
 	{
-		auto_duration dur(stat.unpack_time_sum);
+		auto_duration dur(stat.unpack_time_sum, stat_lock);
 		return unpacker_->completion_condition(ec, bytes_transferred);
 	}
 
@@ -249,19 +414,67 @@ private:
 #ifdef ASCS_PASSIVE_RECV
 			reading = true;
 #endif
+#ifdef ASCS_SPECULATIVE_RECV
+			//only one continuous buffer can be read speculatively, and ssl streams cannot be read speculatively
+			speculative_recv(recv_buff, std::integral_constant<bool,
+				std::is_convertible<decltype(recv_buff), asio::mutable_buffer>::value && std::is_base_of<typename Socket::lowest_layer_type, Socket>::value>());
+#else
 			asio::async_read(this->next_layer(), recv_buff,
 				[this](const asio::error_code& ec, size_t bytes_transferred)->size_t {return this->completion_checker(ec, bytes_transferred);}, make_strand_handler(strand,
-					this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->recv_handler(ec, bytes_transferred);})));
+					make_memory_handler(recv_memory, this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->recv_handler(ec, bytes_transferred);}))));
+#endif
 		}
 	}
 
+#ifdef ASCS_SPECULATIVE_RECV
+	template<typename Buffer> void speculative_recv(const Buffer& recv_buff, std::false_type) {async_recv(recv_buff, 0);}
+	void speculative_recv(const asio::mutable_buffer& recv_buff, std::true_type)
+	{
+		size_t read_size = 0;
+		//at most ASCS_SPECULATIVE_RECV speculative readings in a row, then go back to the reactor to let other sockets run
+		if (recv_budget > 0 && this->lowest_layer().non_blocking())
+		{
+			--recv_budget;
+			asio::error_code ec;
+			auto buff_size = asio::buffer_size(recv_buff);
+			for (auto n = completion_checker(ec, 0); n > 0 && read_size < buff_size; n = completion_checker(ec, read_size))
+			{
+				read_size += this->next_layer().read_some(asio::buffer(recv_buff + read_size, n), ec);
+				if (ec) //would_block and other errors, leave them to async reading
+					break;
+			}
+
+			if (!ec)
+			{
+				recv_handler(ec, read_size);
+				return;
+			}
+		}
+
+		recv_budget = ASCS_SPECULATIVE_RECV; //the next async reading starts a new round
+		async_recv(recv_buff + read_size, read_size);
+	}
+
+	//read_size bytes have been read into the buffer before recv_buff
+	template<typename Buffer> void async_recv(const Buffer& recv_buff, size_t read_size)
+	{
+		asio::async_read(this->next_layer(), recv_buff,
+			[this, read_size](const asio::error_code& ec, size_t bytes_transferred)->size_t {return this->completion_checker(ec, read_size + bytes_transferred);},
+			make_strand_handler(strand, make_memory_handler(recv_memory, this->make_handler_error_size([this, read_size](const asio::error_code& ec, size_t bytes_transferred) {
+				this->recv_handler(ec, read_size + bytes_transferred);}))));
+	}
+#endif
+
 	void recv_handler(const asio::error_code& ec, size_t bytes_transferred)
 	{
 		if (!ec && bytes_transferred > 0)
 		{
-			stat.last_recv_time = time(nullptr);
+			{
+				std::lock_guard<seq_lock> lock(stat_lock);
+				stat.last_recv_time = coarse_clock::now();
+			}
 
-			auto_duration dur(stat.unpack_time_sum);
+			auto_duration dur(stat.unpack_time_sum, stat_lock);
 			auto unpack_ok = unpacker_->parse_msg(bytes_transferred, temp_msg_can);
 			dur.end();
 
@@ -293,6 +506,16 @@ private:
 	{
 		if (!in_strand && sending)
 			return true;
+#ifdef ASCS_SEND_COALESCING
+		else if (coalesce_delay > 0 && !flushing && !send_msg_buffer.empty() && send_msg_buffer.size_in_byte() < coalesce_size)
+		{
+			if (!holding)
+				hold_sending();
+			return true;
+		}
+
+		holding = false; //enough bytes (or the timer expired), the timer will find holding is false
+#endif
 
 		auto end_time = statistic::now();
 #ifdef ASCS_WANT_MSG_SEND_NOTIFY
@@ -300,44 +523,278 @@ private:
 #else
 		send_msg_buffer.move_items_out(asio::detail::default_max_transfer_size, last_send_msg);
 #endif
-		std::vector<asio::const_buffer> bufs;
-		bufs.reserve(last_send_msg.size());
+		auto& bufs = send_bufs;
+		bufs.clear(); //keep the capacity
+		typename statistic::stat_duration send_delay;
+#ifdef ASCS_FULL_STATISTIC
+		send_delay = statistic::stat_duration(0);
+#endif
 		for (auto iter = std::begin(last_send_msg); iter != std::end(last_send_msg); ++iter)
 		{
-			stat.send_delay_sum += end_time - iter->begin_time;
+			send_delay += end_time - iter->begin_time;
+			ASCS_THREAD_STAT_HISTOGRAM_ADD(send_delay_histogram, end_time - iter->begin_time);
 			bufs.emplace_back(iter->data(), iter->size());
 		}
+		if (!bufs.empty())
+		{
+			{
+				std::lock_guard<seq_lock> lock(stat_lock);
+				stat.send_delay_sum += send_delay;
+			}
+			ASCS_THREAD_STAT_DURATION_ADD(send_delay_sum, send_delay);
+		}
 
 		if ((sending = !bufs.empty()))
 		{
 			last_send_msg.front().restart();
-			asio::async_write(this->next_layer(), bufs, make_strand_handler(strand,
-				this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->send_handler(ec, bytes_transferred);})));
+#ifdef ASCS_ZEROCOPY_SEND
+			zerocopy_calls = 0;
+			if ((zerocopy_sending = zerocopy && asio::buffer_size(buffers_ref{&bufs}) >= ASCS_ZEROCOPY_SEND))
+			{
+				zerocopy_send(0, std::integral_constant<bool, std::is_base_of<typename Socket::lowest_layer_type, Socket>::value>());
+				return true;
+			}
+#endif
+#ifdef ASCS_SPECULATIVE_SEND
+			size_t sent_size = 0;
+			//only when the sending side was idle (not called by send_handler), so one speculative sending at most per async sending
+			if (!in_strand && std::is_base_of<typename Socket::lowest_layer_type, Socket>::value && this->lowest_layer().non_blocking())
+			{
+				asio::error_code ec;
+				auto size = asio::buffer_size(buffers_ref{&bufs});
+				sent_size = this->next_layer().write_some(buffers_ref{&bufs}, ec); //would_block and other errors return 0
+				if (sent_size == size)
+				{
+					send_handler(ec, sent_size);
+					return true;
+				}
+
+				consume_send_bufs(sent_size); //async sending for the remainder, errors (if any) will be reported by it again
+			}
+			asio::async_write(this->next_layer(), buffers_ref{&bufs}, make_strand_handler(strand,
+				make_memory_handler(send_memory, this->make_handler_error_size([this, sent_size](const asio::error_code& ec, size_t bytes_transferred) {
+					this->send_handler(ec, sent_size + bytes_transferred);}))));
+#else
+			asio::async_write(this->next_layer(), buffers_ref{&bufs}, make_strand_handler(strand,
+				make_memory_handler(send_memory, this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->send_handler(ec, bytes_transferred);}))));
+#endif
 			return true;
 		}
+#ifdef ASCS_SEND_COALESCING
+		else if (corked) //all messages have been sent
+			set_cork(false);
+#endif
 
 		return false;
 	}
 
+#ifdef ASCS_SEND_COALESCING
+	void hold_sending()
+	{
+		holding = true;
+		sending = false; //let new messages invoke do_send_msg to check the size
+		if (cork && !corked)
+			set_cork(true);
+
+		if (!coalesce_timer) //coalescing is off by default, so create the timer when a socket holds its sending for the first time
+#if ASIO_VERSION >= 101100
+			coalesce_timer.reset(new asio::steady_timer(strand.context()));
+#else
+			coalesce_timer.reset(new asio::steady_timer(strand.get_io_service()));
+#endif
+
+#if ASIO_VERSION >= 101100
+		coalesce_timer->expires_after(std::chrono::microseconds(coalesce_delay));
+#else
+		coalesce_timer->expires_from_now(std::chrono::microseconds(coalesce_delay));
+#endif
+		//an expired waiting can be queued already when a new holding begins (expires_after cannot cancel it), the sequence tells them apart
+		auto seq = ++hold_seq;
+		coalesce_timer->async_wait(make_strand_handler(strand, this->make_handler_error([this, seq](const asio::error_code& ec) {
+			if (!ec && seq == this->hold_seq && this->holding && this->is_ready()) //otherwise, messages will be sent after the next connection established
+			{
+				this->flushing = true;
+				this->do_send_msg(true);
+				this->flushing = false;
+			}
+		})));
+	}
+
+	void set_cork(bool on)
+	{
+#ifdef __linux__
+		asio::error_code ec;
+		this->lowest_layer().set_option(asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_CORK>(on), ec);
+		corked = on && !ec;
+#else
+		(void) on;
+#endif
+	}
+#endif
+
+#if defined(ASCS_SPECULATIVE_SEND) || defined(ASCS_ZEROCOPY_SEND)
+	//remove the first size bytes (less than the total size) from send_bufs
+	void consume_send_bufs(size_t size)
+	{
+		auto iter = std::begin(send_bufs);
+		for (; size >= asio::buffer_size(*iter); ++iter)
+			size -= asio::buffer_size(*iter);
+
+		*iter = *iter + size;
+		send_bufs.erase(std::begin(send_bufs), iter);
+	}
+#endif
+
+#ifdef ASCS_ZEROCOPY_SEND
+	void zerocopy_send(size_t sent_size, std::false_type) {assert(false);} //zero-copy is never enabled for ssl streams
+	void zerocopy_send(size_t sent_size, std::true_type)
+	{
+		//unlike async_write, async_send returns after one successful sendmsg, and the kernel gives every successful one a notification id
+		this->next_layer().async_send(buffers_ref{&send_bufs}, MSG_ZEROCOPY, make_strand_handler(strand,
+			make_memory_handler(send_memory, this->make_handler_error_size([this, sent_size](const asio::error_code& ec, size_t bytes_transferred) {
+				if (!ec)
+					++this->zerocopy_calls;
+
+				if (!ec && bytes_transferred < asio::buffer_size(buffers_ref{&this->send_bufs}))
+				{
+					this->consume_send_bufs(bytes_transferred);
+					this->zerocopy_send(sent_size + bytes_transferred, std::true_type());
+				}
+				else
+					this->send_handler(ec, sent_size + bytes_transferred);
+			}))));
+	}
+
+	//keep sent messages until the kernel released them, messages which were not sent with MSG_ZEROCOPY also need to be kept if there're
+	// messages before them still being kept, to notify them in order.
+	//if ec is set, the write failed after some successful sendings, on_send_error will be called when the kernel released the messages.
+	void keep_zerocopy_msgs(const asio::error_code& ec = asio::error_code())
+	{
+		zerocopy_msgs.emplace_back();
+		auto& item = zerocopy_msgs.back();
+		item.num = zerocopy_sending ? zerocopy_calls : 0;
+		item.ec = ec;
+		item.msg_can.swap(last_send_msg);
+
+		release_zerocopy_msgs();
+	}
+
+	void release_zerocopy_msgs()
+	{
+		if (!zerocopy_waiting && !zerocopy_msgs.empty() && this->started()) //after closing, is_ready_to_close reads the error queue
+		{
+			//wait before reading the error queue, so notifications arrive after the reading will not be missed
+			zerocopy_waiting = true;
+			this->lowest_layer().async_wait(asio::socket_base::wait_error, make_strand_handler(strand, this->make_handler_error([this](const asio::error_code& ec) {
+				this->zerocopy_waiting = false;
+				if (!ec)
+					this->release_zerocopy_msgs();
+			})));
+		}
+
+		char control[128];
+		msghdr msg = msghdr();
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		while (recvmsg(this->lowest_layer().native_handle(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) >= 0) //until EAGAIN
+		{
+			for (auto cmsg = CMSG_FIRSTHDR(&msg); nullptr != cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+				if ((SOL_IP == cmsg->cmsg_level && IP_RECVERR == cmsg->cmsg_type) || (SOL_IPV6 == cmsg->cmsg_level && IPV6_RECVERR == cmsg->cmsg_type))
+				{
+					auto err = (const sock_extended_err*) CMSG_DATA(cmsg);
+					if (SO_EE_ORIGIN_ZEROCOPY == err->ee_origin && 0 == err->ee_errno)
+					{
+						if (SO_EE_CODE_ZEROCOPY_COPIED & err->ee_code)
+							zerocopy = false; //copying plus notifications is worse than copying only
+						zerocopy_completed(err->ee_info, err->ee_data);
+					}
+				}
+
+			msg.msg_controllen = sizeof(control);
+		}
+
+		//the notification ids of the first message being kept start from zerocopy_done_id
+		while (!zerocopy_msgs.empty() && zerocopy_msgs.front().num <= zerocopy_done.size() &&
+			std::all_of(std::begin(zerocopy_done), std::next(std::begin(zerocopy_done), zerocopy_msgs.front().num), [](bool done) {return done;}))
+		{
+			zerocopy_done.erase(std::begin(zerocopy_done), std::next(std::begin(zerocopy_done), zerocopy_msgs.front().num));
+			zerocopy_done_id += zerocopy_msgs.front().num;
+
+			auto ec = zerocopy_msgs.front().ec;
+			typename super::in_container_type msg_can;
+			msg_can.swap(zerocopy_msgs.front().msg_can);
+			zerocopy_msgs.pop_front(); //before notifying, sending in the notification may reenter this function
+			if (ec)
+				on_send_error(ec, msg_can);
+			else
+				notify_msgs_send(msg_can);
+		}
+	}
+
+	//close the connection with RST, then the kernel discards unsent data immediately, so kept messages can be freed (they may not
+	// have been delivered, so on_send_error will be called for them).
+	void abort_zerocopy_msgs()
+	{
+		if (zerocopy_msgs.empty())
+			return;
+
+		unified_out::warning_out("abort the connection, messages sent with MSG_ZEROCOPY have not been released by the kernel.");
+		asio::error_code ec;
+		this->lowest_layer().set_option(asio::socket_base::linger(true, 0), ec);
+		this->lowest_layer().close(ec);
+
+		while (!zerocopy_msgs.empty())
+		{
+			ec = zerocopy_msgs.front().ec ? zerocopy_msgs.front().ec : asio::error::operation_aborted;
+			typename super::in_container_type msg_can;
+			msg_can.swap(zerocopy_msgs.front().msg_can);
+			zerocopy_msgs.pop_front();
+			on_send_error(ec, msg_can);
+		}
+	}
+
+	//notification ids from lo to hi (inclusive, they may wrap around) have been completed, a completion may arrive before its sending
+	// handler been invoked (so before its messages been kept).
+	void zerocopy_completed(uint32_t lo, uint32_t hi)
+	{
+		for (auto id = lo;; ++id)
+		{
+			auto index = (uint32_t) (id - zerocopy_done_id);
+			if (index >= zerocopy_done.size())
+				zerocopy_done.resize(index + 1, false);
+			zerocopy_done[index] = true;
+
+			if (id == hi)
+				break;
+		}
+	}
+#endif
+
 	void send_handler(const asio::error_code& ec, size_t bytes_transferred)
 	{
 		if (!ec)
 		{
-			stat.last_send_time = time(nullptr);
+			auto send_time = statistic::now() - last_send_msg.front().begin_time;
+			{
+				std::lock_guard<seq_lock> lock(stat_lock);
+				stat.last_send_time = coarse_clock::now();
 
-			stat.send_byte_sum += bytes_transferred;
-			stat.send_time_sum += statistic::now() - last_send_msg.front().begin_time;
-			stat.send_msg_sum += last_send_msg.size();
+				stat.send_byte_sum += bytes_transferred;
+				stat.send_time_sum += send_time;
+				stat.send_msg_sum += last_send_msg.size();
+			}
+			ASCS_THREAD_STAT_ADD(send_byte_sum, bytes_transferred);
+			ASCS_THREAD_STAT_DURATION_ADD(send_time_sum, send_time);
+			ASCS_THREAD_STAT_ADD(send_msg_sum, last_send_msg.size());
 #ifdef ASCS_SYNC_SEND
 			ascs::do_something_to_all(last_send_msg, [](typename super::in_msg& item) {if (item.p) {item.p->set_value(sync_call_result::SUCCESS);}});
 #endif
-#ifdef ASCS_WANT_MSG_SEND_NOTIFY
-			this->on_msg_send(last_send_msg.front());
-#endif
-#ifdef ASCS_WANT_ALL_MSG_SEND_NOTIFY
-			if (send_msg_buffer.empty())
-				this->on_all_msg_send(last_send_msg.back());
+#ifdef ASCS_ZEROCOPY_SEND
+			if (zerocopy_sending || !zerocopy_msgs.empty())
+				keep_zerocopy_msgs();
+			else
 #endif
+			notify_msgs_send(last_send_msg);
 			last_send_msg.clear();
 			if (!do_send_msg(true) && !send_msg_buffer.empty()) //send msg in sequence
 				do_send_msg(true); //just make sure no pending msgs
@@ -346,6 +803,12 @@ private:
 		{
 #ifdef ASCS_SYNC_SEND
 			ascs::do_something_to_all(last_send_msg, [](typename super::in_msg& item) {if (item.p) {item.p->set_value(sync_call_result::NOT_APPLICABLE);}});
+#endif
+#ifdef ASCS_ZEROCOPY_SEND
+			zerocopy = false;
+			if (zerocopy_sending && zerocopy_calls > 0) //the kernel may still be reading these messages
+				keep_zerocopy_msgs(ec);
+			else
 #endif
 			on_send_error(ec, last_send_msg);
 			last_send_msg.clear(); //clear sending messages after on_send_error, then user can decide how to deal with them in on_send_error
@@ -354,6 +817,25 @@ private:
 		}
 	}
 
+	void notify_msgs_send(typename super::in_container_type& msg_can)
+	{
+#ifdef ASCS_WANT_MSG_SEND_NOTIFY
+		this->on_msg_send(msg_can.front());
+#endif
+#ifdef ASCS_WANT_BATCH_MSG_SEND_NOTIFY
+		on_msgs_send(msg_can);
+#endif
+#ifdef ASCS_WANT_ALL_MSG_SEND_NOTIFY
+#ifdef ASCS_ZEROCOPY_SEND
+		if (!zerocopy_msgs.empty()) //more messages are being kept
+			return;
+#endif
+		if (send_msg_buffer.empty() && !msg_can.empty()) //on_msgs_send may have taken all messages
+			this->on_all_msg_send(msg_can.back());
+#endif
+		(void) msg_can;
+	}
+
 	bool async_shutdown_handler(size_t loop_num)
 	{
 		if (link_status::GRACEFUL_SHUTTING_DOWN == status)
@@ -379,6 +861,7 @@ protected:
 
 private:
 	using super::stat;
+	using super::stat_lock;
 	using super::packer_;
 	using super::temp_msg_can;
 
@@ -389,9 +872,54 @@ private:
 	using super::reading;
 #endif
 
+	//asio copies the buffer sequence into its operation, copying a vector means a heap allocation for every sending
+	struct buffers_ref
+	{
+		typedef asio::const_buffer value_type;
+		typedef std::vector<asio::const_buffer>::const_iterator const_iterator;
+
+		const_iterator begin() const {return bufs->begin();}
+		const_iterator end() const {return bufs->end();}
+
+		const std::vector<asio::const_buffer>* bufs;
+	};
+
 	std::shared_ptr<i_unpacker<out_msg_type>> unpacker_;
 	typename super::in_container_type last_send_msg;
+	std::vector<asio::const_buffer> send_bufs; //only accessed by sending, which is in sequence
+#ifdef ASCS_SINGLE_STRAND_SOCKET
+	asio::io_context::strand& strand; //the one which dispatches messages
+#else
 	asio::io_context::strand strand;
+#endif
+#ifdef ASCS_HANDLER_MEMORY
+	handler_memory<> recv_memory, send_memory;
+#endif
+#ifdef ASCS_SPECULATIVE_RECV
+	unsigned recv_budget; //only accessed by receiving, which is in sequence
+#endif
+#ifdef ASCS_SEND_COALESCING
+	unsigned coalesce_delay; //microseconds
+	size_t coalesce_size;
+	bool cork, corked, holding, flushing; //the last three are only accessed by sending, which is in sequence
+	size_t hold_seq; //so is this one
+	std::unique_ptr<asio::steady_timer> coalesce_timer; //waits in the strand, lighter than ascs::timer, created on first use
+#endif
+#ifdef ASCS_ZEROCOPY_SEND
+	struct zerocopy_item
+	{
+		uint32_t num; //how many notification ids the write got (successful MSG_ZEROCOPY sendings), they follow the previous write's
+		asio::error_code ec; //the write failed after num successful sendings
+		typename super::in_container_type msg_can;
+	};
+
+	//all of them are only accessed by sending (which is in sequence), and by closing after all async calls finished
+	bool zerocopy, zerocopy_sending, zerocopy_waiting, zerocopy_closing;
+	std::chrono::steady_clock::time_point zerocopy_close_time;
+	uint32_t zerocopy_done_id, zerocopy_calls; //the id of zerocopy_done.front(), and successful sendings of the current write
+	std::deque<bool> zerocopy_done; //completion of notification ids, from the first message being kept
+	list<zerocopy_item> zerocopy_msgs;
+#endif
 };
 
 }} //namespace
@@ -13,6 +13,9 @@
 #ifndef _ASCS_TIMER_H_
 #define _ASCS_TIMER_H_
 
+#ifdef ASCS_USE_TIMING_WHEEL
+#include "timing_wheel.h"
+#else
 #ifdef ASCS_USE_STEADY_TIMER
 #include <asio/steady_timer.hpp>
 #else
@@ -20,6 +23,8 @@
 #endif
 
 #include "base.h"
+#endif
+#include "executor.h"
 
 //If you inherit a class from class X, your own timer ids must begin from X::TIMER_END
 namespace ascs
@@ -29,6 +34,9 @@ namespace ascs
 //for the same timer in the same timer object, any manipulations are not thread safe, please pay special attention.
 //to resolve this defect, we must add a mutex member variable to timer_info, it's not worth. otherwise, they are thread safe.
 //
+//timers whose id less than ASCS_TIMER_TABLE_SIZE are kept in a fixed array indexed by id and created on demand, looking them up
+// (is_timer, find_timer, etc.) is lock-free, other timers are kept in a list protected by a mutex.
+//
 //suppose you have more than one service thread(see service_pump for service thread number controlling), then:
 //for same timer object: same timer, on_timer is called in sequence
 //for same timer object: distinct timer, on_timer is called concurrently
@@ -44,6 +52,7 @@ public:
 #endif
 
 	typedef unsigned short tid;
+	typedef inplace_function<bool(tid)> call_back_type; //return true from call_back to continue the timer, or the timer will stop
 	static const tid TIMER_END = 0; //subclass' id must begin from parent class' TIMER_END
 
 	struct timer_info
@@ -52,23 +61,64 @@ public:
 
 		tid id;
 		unsigned char seq;
-		timer_status status;
+		std::atomic<timer_status> status;
 		unsigned interval_ms;
+#ifdef ASCS_USE_TIMING_WHEEL
+		timing_wheel::node node;
+#else
 		timer_type timer;
-		std::function<bool(tid)> call_back; //return true from call_back to continue the timer, or the timer will stop
+#endif
+		call_back_type call_back; //return true from call_back to continue the timer, or the timer will stop
+#if defined(ASCS_HANDLER_MEMORY) && !defined(ASCS_USE_TIMING_WHEEL)
+		handler_memory<ASCS_SMALL_HANDLER_MEMORY_SIZE> memory; //re-starting a waiting timer overlaps its canceled waiting, the new one will use the heap
+#endif
 
+#ifdef ASCS_USE_TIMING_WHEEL
+		timer_info(tid id_, asio::io_context& io_context_) : id(id_), seq(-1), status(TIMER_CREATED), interval_ms(0) {}
+#else
 		timer_info(tid id_, asio::io_context& io_context_) : id(id_), seq(-1), status(TIMER_CREATED), interval_ms(0), timer(io_context_) {}
+#endif
 		bool operator ==(const timer_info& other) {return id == other.id;}
 		bool operator ==(tid id_) {return id == id_;}
 	};
 	typedef const timer_info timer_cinfo;
 
-	timer(asio::io_context& io_context_) : Executor(io_context_) {}
-	~timer() {stop_all_timer();}
+#ifdef ASCS_USE_TIMING_WHEEL
+	timer(asio::io_context& io_context_) : Executor(io_context_), wheel(asio::use_service<timing_wheel>(io_context_)) {for (auto& item : timer_table) item = nullptr;}
+#else
+	timer(asio::io_context& io_context_) : Executor(io_context_) {for (auto& item : timer_table) item = nullptr;}
+#endif
+	~timer()
+	{
+		stop_all_timer();
+#ifdef ASCS_USE_TIMING_WHEEL
+		//stop_all_timer only stops timers in TIMER_STARTED status, but change_timer_status can change it while the node is still in the wheel,
+		// which must not keep links to destroyed nodes. handlers cannot be invoked after timer_info been destroyed, so drop them.
+		do_something_to_all([this](timer_info& item) {this->wheel.erase(item.node);});
+#endif
+		for (auto& item : timer_table) delete item.load(std::memory_order_relaxed);
+	}
 
-	bool create_or_update_timer(tid id, unsigned interval, std::function<bool(tid)>&& call_back, bool start = false)
+	bool create_or_update_timer(tid id, unsigned interval, call_back_type&& call_back, bool start = false)
 	{
 		timer_info* ti = nullptr;
+		if (id < ASCS_TIMER_TABLE_SIZE)
+		{
+			ti = timer_table[id].load(std::memory_order_acquire);
+			if (nullptr == ti)
+			{
+				try {ti = new timer_info(id, io_context_);}
+				catch (const std::exception& e) {unified_out::error_out("cannot create timer %d (%s)", id, e.what()); return false;}
+
+				timer_info* pre_ti = nullptr; //another thread may created the same timer just now
+				if (!timer_table[id].compare_exchange_strong(pre_ti, ti, std::memory_order_acq_rel, std::memory_order_acquire))
+				{
+					delete ti;
+					ti = pre_ti;
+				}
+			}
+		}
+		else
 		{
 			std::lock_guard<std::mutex> lock(timer_can_mutex);
 			auto iter = std::find(std::begin(timer_can), std::end(timer_can), id);
@@ -90,20 +140,19 @@ public:
 
 		return true;
 	}
-	bool create_or_update_timer(tid id, unsigned interval, const std::function<bool(tid)>& call_back, bool start = false)
-		{return create_or_update_timer(id, interval, std::function<bool(tid)>(call_back), start);}
 
 	bool change_timer_status(tid id, typename timer_info::timer_status status) {auto ti = find_timer(id); return nullptr != ti ? ti->status = status, true : false;}
 	bool change_timer_interval(tid id, size_t interval) {auto ti = find_timer(id); return nullptr != ti ? ti->interval_ms = interval, true : false;}
 
-	bool change_timer_call_back(tid id, std::function<bool(tid)>&& call_back) {auto ti = find_timer(id); return nullptr != ti ? ti->call_back.swap(call_back), true : false;}
-	bool change_timer_call_back(tid id, const std::function<bool(tid)>& call_back) {return change_timer_call_back(id, std::function<bool(tid)>(call_back));}
-
-	bool set_timer(tid id, unsigned interval, std::function<bool(tid)>&& call_back) {return create_or_update_timer(id, interval, std::move(call_back), true);}
-	bool set_timer(tid id, unsigned interval, const std::function<bool(tid)>& call_back) {return create_or_update_timer(id, interval, call_back, true);}
+	//call_back can be any callable objects (lambda, std::function, etc.), they will be converted to call_back_type implicitly.
+	bool change_timer_call_back(tid id, call_back_type&& call_back) {auto ti = find_timer(id); return nullptr != ti ? ti->call_back.swap(call_back), true : false;}
+	bool set_timer(tid id, unsigned interval, call_back_type&& call_back) {return create_or_update_timer(id, interval, std::move(call_back), true);}
 
 	timer_info* find_timer(tid id)
 	{
+		if (id < ASCS_TIMER_TABLE_SIZE)
+			return timer_table[id].load(std::memory_order_acquire);
+
 		std::lock_guard<std::mutex> lock(timer_can_mutex);
 		auto iter = std::find(std::begin(timer_can), std::end(timer_can), id);
 		if (iter != std::end(timer_can))
@@ -118,8 +167,31 @@ public:
 	void stop_all_timer() {do_something_to_all([this](timer_info& item) {this->stop_timer(item);});}
 	void stop_all_timer(tid excepted_id) {do_something_to_all([=](timer_info& item) {if (excepted_id != item.id) this->stop_timer(item);});}
 
-	DO_SOMETHING_TO_ALL_MUTEX(timer_can, timer_can_mutex)
-	DO_SOMETHING_TO_ONE_MUTEX(timer_can, timer_can_mutex)
+	template<typename _Predicate> void do_something_to_all(const _Predicate& __pred)
+	{
+		for (auto& item : timer_table)
+		{
+			auto ti = item.load(std::memory_order_acquire);
+			if (nullptr != ti)
+				__pred(*ti);
+		}
+
+		std::lock_guard<std::mutex> lock(timer_can_mutex);
+		for (auto& item : timer_can) __pred(item);
+	}
+
+	template<typename _Predicate> void do_something_to_one(const _Predicate& __pred)
+	{
+		for (auto& item : timer_table)
+		{
+			auto ti = item.load(std::memory_order_acquire);
+			if (nullptr != ti && __pred(*ti))
+				return;
+		}
+
+		std::lock_guard<std::mutex> lock(timer_can_mutex);
+		for (auto iter = std::begin(timer_can); iter != std::end(timer_can); ++iter) if (__pred(*iter)) break;
+	}
 
 protected:
 	bool start_timer(timer_info& ti, unsigned interval_ms)
@@ -128,24 +200,25 @@ protected:
 			return false;
 
 		ti.status = timer_info::TIMER_STARTED;
+#ifndef ASCS_USE_TIMING_WHEEL
 #if ASIO_VERSION >= 101100
 		ti.timer.expires_after(std::chrono::milliseconds(interval_ms));
 #else
 		ti.timer.expires_from_now(std::chrono::milliseconds(interval_ms));
 #endif
+#endif
 
-		//if timer already started, this will cancel it first
 #if (defined(_MSC_VER) && _MSC_VER > 1800) || (defined(__cplusplus) && __cplusplus > 201103L)
-		ti.timer.async_wait(this->make_handler_error([this, &ti, prev_seq(++ti.seq)](const asio::error_code& ec) {
+		auto handler = this->make_handler_error([this, &ti, prev_seq(++ti.seq)](const asio::error_code& ec) {
 #else
 		auto prev_seq = ++ti.seq;
-		ti.timer.async_wait(this->make_handler_error([this, &ti, prev_seq](const asio::error_code& ec) {
+		auto handler = this->make_handler_error([this, &ti, prev_seq](const asio::error_code& ec) {
 #endif
 #ifdef ASCS_ALIGNED_TIMER
-			auto begin_time = std::chrono::system_clock::now();
+			auto begin_time = std::chrono::steady_clock::now();
 			if (!ec && ti.call_back(ti.id) && timer_info::TIMER_STARTED == ti.status)
 			{
-				auto elapsed_ms = (unsigned) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - begin_time).count();
+				auto elapsed_ms = (unsigned) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin_time).count();
 				if (elapsed_ms > ti.interval_ms)
 					elapsed_ms %= ti.interval_ms;
 
@@ -157,8 +230,14 @@ protected:
 #endif
 			else if (prev_seq == ti.seq) //exclude a particular situation--start the same timer in call_back and return false
 				ti.status = timer_info::TIMER_CANCELED;
-		}));
+		});
 
+		//if timer already started, this will cancel it first
+#ifdef ASCS_USE_TIMING_WHEEL
+		wheel.schedule(ti.node, interval_ms, std::move(handler));
+#else
+		ti.timer.async_wait(make_memory_handler(ti.memory, std::move(handler)));
+#endif
 		return true;
 	}
 	bool start_timer(timer_info& ti) {return start_timer(ti, ti.interval_ms);}
@@ -167,16 +246,25 @@ protected:
 	{
 		if (timer_info::TIMER_STARTED == ti.status) //enable stopping timers that has been stopped
 		{
+#ifdef ASCS_USE_TIMING_WHEEL
+			wheel.cancel(ti.node);
+#else
 			try {ti.timer.cancel();}
 			catch (const asio::system_error& e) {unified_out::error_out("cannot stop timer %d (%d %s)", ti.id, e.code().value(), e.what());}
+#endif
 			ti.status = timer_info::TIMER_CANCELED;
 		}
 	}
 
 private:
+	std::atomic<timer_info*> timer_table[ASCS_TIMER_TABLE_SIZE];
+
 	typedef std::list<timer_info> container_type;
-	container_type timer_can;
+	container_type timer_can; //timers whose id equal to or bigger than ASCS_TIMER_TABLE_SIZE
 	std::mutex timer_can_mutex;
+#ifdef ASCS_USE_TIMING_WHEEL
+	timing_wheel& wheel;
+#endif
 
 	using Executor::io_context_;
 };
@@ -0,0 +1,287 @@
+/*
+ * timing_wheel.h
+ *
+ * hierarchical timing wheel, it's an asio service, so all timers belong to the same io_context share one wheel
+ */
+
+#ifndef _ASCS_TIMING_WHEEL_H_
+#define _ASCS_TIMING_WHEEL_H_
+
+#include <asio/steady_timer.hpp>
+
+#include "base.h"
+#include "executor.h"
+
+namespace ascs
+{
+
+//4 levels (256 + 64 + 64 + 64 slots), driven by only one asio::steady_timer, which ticks every tick() milliseconds while there are timers
+// in the wheel (and stops ticking if the wheel becomes empty, so service_pump can still stop automatically).
+//arming and canceling are O(1) (plus a mutex), a timer's duration will be rounded up to the tick, timers exceed the maximum range (2^26 ticks)
+// will be cascaded again and again until they expire.
+//like asio timers, expired handlers will be posted with an empty error_code, canceled handlers will be posted with asio::error::operation_aborted.
+template<typename Dummy = void> class basic_timing_wheel : public asio::io_context::service
+{
+private:
+	static const unsigned LV0_BITS = 8, LVN_BITS = 6, LVN_NUM = 3;
+	static const uint_fast64_t LV0_SIZE = 1 << LV0_BITS, LVN_SIZE = 1 << LVN_BITS;
+	static const uint_fast64_t LV0_MASK = LV0_SIZE - 1, LVN_MASK = LVN_SIZE - 1;
+	static const uint_fast64_t MAX_DELTA = ((uint_fast64_t) 1 << (LV0_BITS + LVN_NUM * LVN_BITS)) - 1;
+
+	struct link {link* prev; link* next;};
+
+public:
+#if ASIO_VERSION >= 101100 //move-only handlers are supported
+	typedef inplace_function<void(const asio::error_code&)> handler_type;
+#else
+	typedef std::function<void(const asio::error_code&)> handler_type;
+#endif
+
+	class node : protected link
+	{
+	public:
+		node() : expiry(0) {this->prev = this->next = nullptr;}
+		bool is_linked() const {return nullptr != this->prev;}
+
+	private:
+		friend class basic_timing_wheel;
+
+		uint_fast64_t expiry; //in ticks
+		handler_type handler;
+	};
+
+	static asio::io_context::id id;
+
+	basic_timing_wheel(asio::io_context& io_context_) : asio::io_context::service(io_context_),
+		io_ctx(io_context_), timer(io_context_), tick_ms(ASCS_TIMING_WHEEL_TICK), cur_tick(0), num(0), driving(false)
+	{
+		for (auto& item : lv0) item.prev = item.next = &item;
+		for (auto& level : lvn) for (auto& item : level) item.prev = item.next = &item;
+	}
+
+	//change the tick, only succeed if the wheel is empty.
+	bool tick(unsigned ms)
+	{
+		if (0 == ms)
+			return false;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (num > 0)
+			return false;
+
+		tick_ms = ms;
+		return true;
+	}
+	unsigned tick() const {return tick_ms;}
+	size_t size() const {return num;}
+
+	//if n already been scheduled, it will be canceled first.
+	void schedule(node& n, unsigned interval_ms, handler_type&& handler)
+	{
+		handler_type canceled_handler;
+		auto now = std::chrono::steady_clock::now();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		if (n.is_linked())
+		{
+			unlink(n);
+			canceled_handler.swap(n.handler);
+		}
+
+		if (0 == num && !driving)
+			base_time = now - std::chrono::milliseconds(cur_tick * tick_ms); //realign, no ticks to catch up
+
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - base_time).count() + interval_ms;
+		n.expiry = std::max(cur_tick, (uint_fast64_t) (ms + tick_ms - 1) / tick_ms);
+		n.handler.swap(handler);
+		insert(n);
+
+		auto need_drive = !driving;
+		driving = true;
+		auto next_tick_time = base_time + std::chrono::milliseconds(cur_tick * tick_ms);
+		lock.unlock();
+
+		if (need_drive)
+			drive(next_tick_time);
+		if (canceled_handler)
+			post_handler(std::move(canceled_handler), asio::error::operation_aborted);
+	}
+
+	bool cancel(node& n)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!n.is_linked())
+			return false;
+
+		unlink(n);
+		handler_type canceled_handler;
+		canceled_handler.swap(n.handler);
+		lock.unlock();
+
+		post_handler(std::move(canceled_handler), asio::error::operation_aborted);
+		return true;
+	}
+
+	//like cancel, but the handler will be destroyed without invocation, call it before destroying a node (which must not be left in the wheel).
+	bool erase(node& n)
+	{
+		handler_type erased_handler;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!n.is_linked())
+			return false;
+
+		unlink(n);
+		erased_handler.swap(n.handler);
+		lock.unlock();
+
+		return true;
+	}
+
+private:
+#if ASIO_VERSION >= 101100
+	virtual void shutdown() {clear();}
+#else
+	virtual void shutdown_service() {clear();}
+#endif
+
+	void clear()
+	{
+		std::list<handler_type> handlers;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		auto clear_slot = [&](link& slot) {
+			while (slot.next != &slot)
+			{
+				auto& n = static_cast<node&>(*slot.next);
+				unlink(n);
+				handlers.emplace_back(std::move(n.handler));
+			}
+		};
+		for (auto& item : lv0) clear_slot(item);
+		for (auto& level : lvn) for (auto& item : level) clear_slot(item);
+		lock.unlock();
+		//handlers will be destroyed without invocation, just like asio does
+	}
+
+	void insert(node& n)
+	{
+		auto delta = n.expiry - cur_tick;
+		link* slot;
+		if (delta < LV0_SIZE)
+			slot = &lv0[n.expiry & LV0_MASK];
+		else
+		{
+			auto expiry = delta > MAX_DELTA ? cur_tick + MAX_DELTA : n.expiry; //will be cascaded again
+			auto level = 0U;
+			while (level < LVN_NUM - 1 && delta >= (uint_fast64_t) 1 << (LV0_BITS + (level + 1) * LVN_BITS))
+				++level;
+			slot = &lvn[level][(expiry >> (LV0_BITS + level * LVN_BITS)) & LVN_MASK];
+		}
+
+		n.prev = slot->prev;
+		n.next = slot;
+		slot->prev->next = &n;
+		slot->prev = &n;
+		++num;
+	}
+
+	void unlink(node& n)
+	{
+		n.prev->next = n.next;
+		n.next->prev = n.prev;
+		n.prev = n.next = nullptr;
+		--num;
+	}
+
+	//re-insert all timers in slot into lower levels, return the slot index
+	size_t cascade(unsigned level)
+	{
+		auto index = (size_t) ((cur_tick >> (LV0_BITS + level * LVN_BITS)) & LVN_MASK);
+		auto& slot = lvn[level][index];
+		while (slot.next != &slot)
+		{
+			auto& n = static_cast<node&>(*slot.next);
+			unlink(n);
+			insert(n);
+		}
+
+		return index;
+	}
+
+	void drive(const std::chrono::steady_clock::time_point& next_tick_time)
+	{
+		timer.expires_at(next_tick_time);
+		timer.async_wait(make_memory_handler(drive_memory, [this](const asio::error_code& ec) {if (!ec) this->on_tick();}));
+	}
+
+	void on_tick()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		auto target = (uint_fast64_t) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - base_time).count() / tick_ms;
+		for (; num > 0 && cur_tick <= target; ++cur_tick)
+		{
+			auto index = cur_tick & LV0_MASK;
+			for (auto level = 0U; 0 == index && level < LVN_NUM; ++level)
+				index = cascade(level);
+
+			auto& slot = lv0[cur_tick & LV0_MASK];
+			while (slot.next != &slot)
+			{
+				auto& n = static_cast<node&>(*slot.next);
+				unlink(n);
+				post_handler(std::move(n.handler), asio::error_code()); //posting will not invoke the handler, so it's safe under the lock
+			}
+		}
+		if (0 == num)
+			cur_tick = std::max(cur_tick, target + 1);
+
+		auto need_drive = (driving = num > 0);
+		auto next_tick_time = base_time + std::chrono::milliseconds(cur_tick * tick_ms);
+		lock.unlock();
+
+		if (need_drive)
+			drive(next_tick_time);
+	}
+
+	struct handler_invoker
+	{
+		handler_type handler;
+		asio::error_code ec;
+
+		void operator()() {handler(ec);}
+	};
+
+	void post_handler(handler_type&& handler, const asio::error_code& ec)
+	{
+#if ASIO_VERSION >= 101100
+		asio::post(io_ctx, handler_invoker{std::move(handler), ec});
+#else
+		io_ctx.post(handler_invoker{std::move(handler), ec});
+#endif
+	}
+
+private:
+	asio::io_context& io_ctx;
+	asio::steady_timer timer;
+	std::chrono::steady_clock::time_point base_time; //when tick 0 should be processed
+	unsigned tick_ms;
+#ifdef ASCS_HANDLER_MEMORY
+	handler_memory<ASCS_SMALL_HANDLER_MEMORY_SIZE> drive_memory; //driving never overlaps (see driving)
+#endif
+
+	std::mutex mutex;
+	uint_fast64_t cur_tick; //the next tick to be processed
+	size_t num;
+	bool driving;
+
+	link lv0[LV0_SIZE];
+	link lvn[LVN_NUM][LVN_SIZE];
+};
+template<typename Dummy> asio::io_context::id basic_timing_wheel<Dummy>::id;
+
+typedef basic_timing_wheel<> timing_wheel;
+
+} //namespace
+
+#endif /* _ASCS_TIMING_WHEEL_H_ */
@@ -23,61 +23,108 @@ class tracked_executor
 {
 protected:
 	virtual ~tracked_executor() {}
-	tracked_executor(asio::io_context& _io_context_) : io_context_(_io_context_), aci(std::make_shared<char>('\0')) {}
+	tracked_executor(asio::io_context& _io_context_) : io_context_(_io_context_) {}
+
+	//a reference of the asynchronous calling indicator, works like a copy of std::shared_ptr, but the counter is embedded in tracked_executor
+	// (no control block), and moving it (handlers are moved again and again by asio and inplace_function) costs no atomic operations.
+	class aci_ref
+	{
+	public:
+		aci_ref(const tracked_executor* owner) : aci(&owner->aci.num) {aci->fetch_add(1, std::memory_order_relaxed);}
+		aci_ref(const aci_ref& other) : aci(other.aci) {if (nullptr != aci) aci->fetch_add(1, std::memory_order_relaxed);}
+		aci_ref(aci_ref&& other) noexcept : aci(other.aci) {other.aci = nullptr;}
+		~aci_ref() {if (nullptr != aci) aci->fetch_sub(1, std::memory_order_release);}
+
+	private:
+		aci_ref& operator=(const aci_ref&);
+
+	private:
+		std::atomic_size_t* aci;
+	};
 
 public:
+#if ASIO_VERSION >= 101100 //move-only handlers are supported
+	typedef inplace_function<void()> plain_handler;
+	typedef inplace_function<void(const asio::error_code&)> handler_with_error;
+	typedef inplace_function<void(const asio::error_code&, size_t)> handler_with_error_size;
+#else
+	typedef std::function<void()> plain_handler;
 	typedef std::function<void(const asio::error_code&)> handler_with_error;
 	typedef std::function<void(const asio::error_code&, size_t)> handler_with_error_size;
+#endif
 
 	bool stopped() const {return io_context_.stopped();}
 
 #if (defined(_MSC_VER) && _MSC_VER > 1800) || (defined(__cplusplus) && __cplusplus > 201103L)
 	#if ASIO_VERSION >= 101100
-	template<typename F> void post(F&& handler) {asio::post(io_context_, [ref_holder(this->aci), handler(std::forward<F>(handler))]() {handler();});}
-	template<typename F> void defer(F&& handler) {asio::defer(io_context_, [ref_holder(this->aci), handler(std::forward<F>(handler))]() {handler();});}
-	template<typename F> void dispatch(F&& handler) {asio::dispatch(io_context_, [ref_holder(this->aci), handler(std::forward<F>(handler))]() {handler();});}
-	template<typename F> void post_strand(asio::io_context::strand& strand, F&& handler) {asio::post(strand, [ref_holder(this->aci), handler(std::forward<F>(handler))]() {handler();});}
-	template<typename F> void defer_strand(asio::io_context::strand& strand, F&& handler) {asio::defer(strand, [ref_holder(this->aci), handler(std::forward<F>(handler))]() {handler();});}
-	template<typename F> void dispatch_strand(asio::io_context::strand& strand, F&& handler) {asio::dispatch(strand, [ref_holder(this->aci), handler(std::forward<F>(handler))]() {handler();});}
+	template<typename F> void post(F&& handler) {asio::post(io_context_, [ref_holder(aci_ref(this)), handler(std::forward<F>(handler))]() {handler();});}
+	template<typename F> void defer(F&& handler) {asio::defer(io_context_, [ref_holder(aci_ref(this)), handler(std::forward<F>(handler))]() {handler();});}
+	template<typename F> void dispatch(F&& handler) {asio::dispatch(io_context_, [ref_holder(aci_ref(this)), handler(std::forward<F>(handler))]() {handler();});}
+	#ifndef ASCS_IO_CONTEXT_PER_THREAD
+	template<typename F> void post_strand(asio::io_context::strand& strand, F&& handler) {asio::post(strand, [ref_holder(aci_ref(this)), handler(std::forward<F>(handler))]() {handler();});}
+	template<typename F> void defer_strand(asio::io_context::strand& strand, F&& handler) {asio::defer(strand, [ref_holder(aci_ref(this)), handler(std::forward<F>(handler))]() {handler();});}
+	template<typename F> void dispatch_strand(asio::io_context::strand& strand, F&& handler) {asio::dispatch(strand, [ref_holder(aci_ref(this)), handler(std::forward<F>(handler))]() {handler();});}
+	#endif
 	#else
-	template<typename F> void post(F&& handler) {io_context_.post([ref_holder(this->aci), handler(std::forward<F>(handler))]() {handler();});}
-	template<typename F> void dispatch(F&& handler) {io_context_.dispatch([ref_holder(this->aci), handler(std::forward<F>(handler))]() {handler();});}
-	template<typename F> void post_strand(asio::io_context::strand& strand, F&& handler) {strand.post([ref_holder(this->aci), handler(std::forward<F>(handler))]() {handler();});}
-	template<typename F> void dispatch_strand(asio::io_context::strand& strand, F&& handler) {strand.dispatch([ref_holder(this->aci), handler(std::forward<F>(handler))]() {handler();});}
+	template<typename F> void post(F&& handler) {io_context_.post([ref_holder(aci_ref(this)), handler(std::forward<F>(handler))]() {handler();});}
+	template<typename F> void dispatch(F&& handler) {io_context_.dispatch([ref_holder(aci_ref(this)), handler(std::forward<F>(handler))]() {handler();});}
+	#ifndef ASCS_IO_CONTEXT_PER_THREAD
+	template<typename F> void post_strand(asio::io_context::strand& strand, F&& handler) {strand.post([ref_holder(aci_ref(this)), handler(std::forward<F>(handler))]() {handler();});}
+	template<typename F> void dispatch_strand(asio::io_context::strand& strand, F&& handler) {strand.dispatch([ref_holder(aci_ref(this)), handler(std::forward<F>(handler))]() {handler();});}
+	#endif
 	#endif
 
-	template<typename F> handler_with_error make_handler_error(F&& handler) const {return [ref_holder(this->aci), handler(std::forward<F>(handler))](const auto& ec) {handler(ec);};}
+	template<typename F> plain_handler make_handler(F&& handler) const {return [ref_holder(aci_ref(this)), handler(std::forward<F>(handler))]() {handler();};}
+	template<typename F> handler_with_error make_handler_error(F&& handler) const {return [ref_holder(aci_ref(this)), handler(std::forward<F>(handler))](const auto& ec) {handler(ec);};}
 	template<typename F> handler_with_error_size make_handler_error_size(F&& handler) const
-		{return [ref_holder(this->aci), handler(std::forward<F>(handler))](const auto& ec, auto bytes_transferred) {handler(ec, bytes_transferred);};}
+		{return [ref_holder(aci_ref(this)), handler(std::forward<F>(handler))](const auto& ec, auto bytes_transferred) {handler(ec, bytes_transferred);};}
 #else
 	#if ASIO_VERSION >= 101100
-	template<typename F> void post(const F& handler) {auto ref_holder(aci); asio::post(io_context_, [=]() {(void) ref_holder; handler();});}
-	template<typename F> void defer(const F& handler) {auto ref_holder(aci); asio::defer(io_context_, [=]() {(void) ref_holder; handler();});}
-	template<typename F> void dispatch(const F& handler) {auto ref_holder(aci); asio::dispatch(io_context_, [=]() {(void) ref_holder; handler();});}
-	template<typename F> void post_strand(asio::io_context::strand& strand, const F& handler) {auto ref_holder(aci); asio::post(strand, [=]() {(void) ref_holder; handler();});}
-	template<typename F> void defer_strand(asio::io_context::strand& strand, const F& handler) {auto ref_holder(aci); asio::defer(strand, [=]() {(void) ref_holder; handler();});}
-	template<typename F> void dispatch_strand(asio::io_context::strand& strand, const F& handler) {auto ref_holder(aci); asio::dispatch(strand, [=]() {(void) ref_holder; handler();});}
+	template<typename F> void post(const F& handler) {aci_ref ref_holder(this); asio::post(io_context_, [=]() {(void) ref_holder; handler();});}
+	template<typename F> void defer(const F& handler) {aci_ref ref_holder(this); asio::defer(io_context_, [=]() {(void) ref_holder; handler();});}
+	template<typename F> void dispatch(const F& handler) {aci_ref ref_holder(this); asio::dispatch(io_context_, [=]() {(void) ref_holder; handler();});}
+	#ifndef ASCS_IO_CONTEXT_PER_THREAD
+	template<typename F> void post_strand(asio::io_context::strand& strand, const F& handler) {aci_ref ref_holder(this); asio::post(strand, [=]() {(void) ref_holder; handler();});}
+	template<typename F> void defer_strand(asio::io_context::strand& strand, const F& handler) {aci_ref ref_holder(this); asio::defer(strand, [=]() {(void) ref_holder; handler();});}
+	template<typename F> void dispatch_strand(asio::io_context::strand& strand, const F& handler) {aci_ref ref_holder(this); asio::dispatch(strand, [=]() {(void) ref_holder; handler();});}
+	#endif
 	#else
-	template<typename F> void post(const F& handler) {auto ref_holder(aci); io_context_.post([=]() {(void) ref_holder; handler();});}
-	template<typename F> void dispatch(const F& handler) {auto ref_holder(aci); io_context_.dispatch([=]() {(void) ref_holder; handler();});}
-	template<typename F> void post_strand(asio::io_context::strand& strand, const F& handler) {auto ref_holder(aci); strand.post([=]() {(void) ref_holder; handler();});}
-	template<typename F> void dispatch_strand(asio::io_context::strand& strand, const F& handler) {auto ref_holder(aci); strand.dispatch([=]() {(void) ref_holder; handler();});}
+	template<typename F> void post(const F& handler) {aci_ref ref_holder(this); io_context_.post([=]() {(void) ref_holder; handler();});}
+	template<typename F> void dispatch(const F& handler) {aci_ref ref_holder(this); io_context_.dispatch([=]() {(void) ref_holder; handler();});}
+	#ifndef ASCS_IO_CONTEXT_PER_THREAD
+	template<typename F> void post_strand(asio::io_context::strand& strand, const F& handler) {aci_ref ref_holder(this); strand.post([=]() {(void) ref_holder; handler();});}
+	template<typename F> void dispatch_strand(asio::io_context::strand& strand, const F& handler) {aci_ref ref_holder(this); strand.dispatch([=]() {(void) ref_holder; handler();});}
+	#endif
 	#endif
 
-	template<typename F> handler_with_error make_handler_error(const F& handler) const {auto ref_holder(aci); return [=](const asio::error_code& ec) {(void) ref_holder; handler(ec);};}
+	template<typename F> plain_handler make_handler(const F& handler) const {aci_ref ref_holder(this); return [=]() {(void) ref_holder; handler();};}
+	template<typename F> handler_with_error make_handler_error(const F& handler) const {aci_ref ref_holder(this); return [=](const asio::error_code& ec) {(void) ref_holder; handler(ec);};}
 	template<typename F> handler_with_error_size make_handler_error_size(const F& handler) const
-		{auto ref_holder(aci); return [=](const asio::error_code& ec, size_t bytes_transferred) {(void) ref_holder; handler(ec, bytes_transferred);};}
+		{aci_ref ref_holder(this); return [=](const asio::error_code& ec, size_t bytes_transferred) {(void) ref_holder; handler(ec, bytes_transferred);};}
+#endif
+#ifdef ASCS_IO_CONTEXT_PER_THREAD
+	ELIDED_STRAND_FUNCTIONS
 #endif
 
-	bool is_async_calling() const {return !aci.unique();}
-	bool is_last_async_call() const {return aci.use_count() <= 2;} //can only be called in callbacks
+	bool is_async_calling() const {return aci.num.load(std::memory_order_acquire) > 0;}
+	bool is_last_async_call() const {return aci.num.load(std::memory_order_acquire) <= 1;} //can only be called in callbacks
 	inline void set_async_calling(bool) {}
 
 protected:
 	asio::io_context& io_context_;
 
 private:
-	std::shared_ptr<char> aci; //asynchronous calling indicator
+	//all threads which issue async calls on this object modify the counter, keep it away from the vtable pointer and other members
+	// (which are mostly read by these threads), objects are not necessarily aligned to cache line, so padding is on both sides.
+	struct padded_counter
+	{
+		padded_counter() : num(0) {}
+
+		char padding1[64 - sizeof(std::atomic_size_t)];
+		std::atomic_size_t num;
+		char padding2[64 - sizeof(std::atomic_size_t)];
+	};
+	mutable padded_counter aci; //asynchronous calling indicator, the number of outstanding handlers
 };
 #else
 class tracked_executor : public executor
@@ -32,8 +32,12 @@ private:
 	typedef socket<Socket, Packer, in_msg_type, out_msg_type, InQueue, InContainer, OutQueue, OutContainer> super;
 
 public:
-	socket_base(asio::io_context& io_context_) : super(io_context_), strand(io_context_) {first_init();}
-	socket_base(Matrix& matrix_) : super(matrix_.get_service_pump()), strand(matrix_.get_service_pump()) {first_init(&matrix_);}
+#ifdef ASCS_SINGLE_STRAND_SOCKET
+	socket_base(asio::io_context& io_context_) : super(io_context_), strand(super::get_strand()) {first_init(io_context_);}
+#else
+	socket_base(asio::io_context& io_context_) : super(io_context_), strand(io_context_) {first_init(io_context_);}
+#endif
+	socket_base(Matrix& matrix_) : socket_base(matrix_.get_service_pump().assign_io_context(), matrix_) {}
 
 	virtual bool is_ready() {return has_bound;}
 	virtual void send_heartbeat()
@@ -122,7 +126,17 @@ public:
 
 protected:
 	//helper function, just call it in constructor
-	void first_init(Matrix* matrix_ = nullptr) {has_bound = false; unpacker_ = std::make_shared<Unpacker>(); matrix = matrix_;}
+	void first_init(asio::io_context& io_context_, Matrix* matrix_ = nullptr)
+	{
+		has_bound = false;
+#ifdef ASCS_THREAD_PLACEMENT
+		unpacker_ = std::allocate_shared<Unpacker>(numa_allocator<Unpacker>(io_context_node::get(io_context_)));
+#else
+		(void) io_context_;
+		unpacker_ = std::make_shared<Unpacker>();
+#endif
+		matrix = matrix_;
+	}
 
 	Matrix* get_matrix() {return matrix;}
 	const Matrix* get_matrix() const {return matrix;}
@@ -172,7 +186,10 @@ protected:
 
 	virtual bool on_heartbeat_error()
 	{
-		stat.last_recv_time = time(nullptr); //avoid repetitive warnings
+		{
+			std::lock_guard<seq_lock> lock(stat_lock);
+			stat.last_recv_time = coarse_clock::now(); //avoid repetitive warnings
+		}
 		unified_out::warning_out("%s:%hu is not available", peer_addr.address().to_string().data(), peer_addr.port());
 		return true;
 	}
@@ -182,6 +199,13 @@ protected:
 #endif
 
 private:
+	//io_context_ must be the one which matrix_ assigned (see service_pump::assign_io_context)
+#ifdef ASCS_SINGLE_STRAND_SOCKET
+	socket_base(asio::io_context& io_context_, Matrix& matrix_) : super(io_context_), strand(super::get_strand()) {first_init(io_context_, &matrix_);}
+#else
+	socket_base(asio::io_context& io_context_, Matrix& matrix_) : super(io_context_), strand(io_context_) {first_init(io_context_, &matrix_);}
+#endif
+
 #ifndef ASCS_PASSIVE_RECV
 	virtual void recv_msg() {this->dispatch_strand(strand, [this]() {this->do_recv_msg();});}
 #endif
@@ -213,7 +237,7 @@ private:
 			reading = true;
 #endif
 			this->next_layer().async_receive_from(recv_buff, temp_addr, make_strand_handler(strand,
-				this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->recv_handler(ec, bytes_transferred);})));
+				make_memory_handler(recv_memory, this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->recv_handler(ec, bytes_transferred);}))));
 		}
 	}
 
@@ -221,7 +245,10 @@ private:
 	{
 		if (!ec && bytes_transferred > 0)
 		{
-			stat.last_recv_time = time(nullptr);
+			{
+				std::lock_guard<seq_lock> lock(stat_lock);
+				stat.last_recv_time = coarse_clock::now();
+			}
 
 			typename Unpacker::container_type msg_can;
 			unpacker_->parse_msg(bytes_transferred, msg_can);
@@ -259,11 +286,17 @@ private:
 
 		if ((sending = send_msg_buffer.try_dequeue(last_send_msg)))
 		{
-			stat.send_delay_sum += statistic::now() - last_send_msg.begin_time;
+			auto send_delay = statistic::now() - last_send_msg.begin_time;
+			{
+				std::lock_guard<seq_lock> lock(stat_lock);
+				stat.send_delay_sum += send_delay;
+			}
+			ASCS_THREAD_STAT_DURATION_ADD(send_delay_sum, send_delay);
+			ASCS_THREAD_STAT_HISTOGRAM_ADD(send_delay_histogram, send_delay);
 
 			last_send_msg.restart();
 			this->next_layer().async_send_to(asio::buffer(last_send_msg.data(), last_send_msg.size()), last_send_msg.peer_addr, make_strand_handler(strand,
-				this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->send_handler(ec, bytes_transferred);})));
+				make_memory_handler(send_memory, this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->send_handler(ec, bytes_transferred);}))));
 			return true;
 		}
 
@@ -274,11 +307,18 @@ private:
 	{
 		if (!ec)
 		{
-			stat.last_send_time = time(nullptr);
+			auto send_time = statistic::now() - last_send_msg.begin_time;
+			{
+				std::lock_guard<seq_lock> lock(stat_lock);
+				stat.last_send_time = coarse_clock::now();
 
-			stat.send_byte_sum += bytes_transferred;
-			stat.send_time_sum += statistic::now() - last_send_msg.begin_time;
-			++stat.send_msg_sum;
+				stat.send_byte_sum += bytes_transferred;
+				stat.send_time_sum += send_time;
+				++stat.send_msg_sum;
+			}
+			ASCS_THREAD_STAT_ADD(send_byte_sum, bytes_transferred);
+			ASCS_THREAD_STAT_DURATION_ADD(send_time_sum, send_time);
+			ASCS_THREAD_STAT_ADD(send_msg_sum, 1);
 #ifdef ASCS_SYNC_SEND
 			if (last_send_msg.p)
 				last_send_msg.p->set_value(sync_call_result::SUCCESS);
@@ -337,6 +377,7 @@ private:
 
 private:
 	using super::stat;
+	using super::stat_lock;
 	using super::packer_;
 	using super::temp_msg_can;
 
@@ -350,12 +391,19 @@ private:
 	bool has_bound;
 	typename super::in_msg last_send_msg;
 	std::shared_ptr<i_unpacker<typename Unpacker::msg_type>> unpacker_;
+#ifdef ASCS_HANDLER_MEMORY
+	handler_memory<> recv_memory, send_memory;
+#endif
 	asio::ip::udp::endpoint local_addr;
 	asio::ip::udp::endpoint temp_addr; //used when receiving messages
 	asio::ip::udp::endpoint peer_addr;
 
 	Matrix* matrix;
+#ifdef ASCS_SINGLE_STRAND_SOCKET
+	asio::io_context::strand& strand; //the one which dispatches messages
+#else
 	asio::io_context::strand strand;
+#endif
 };
 
 }} //namespace